@@ -55,6 +55,35 @@ void *SymTable_replace(SymTable_T oSymTable,
 
 /*--------------------------------------------------------------------*/
 
+/* If oSymTable contains a binding with key pcKey, then
+SymTable_findOrInsert sets *piInserted to 0 (FALSE). Otherwise it adds
+a new binding consisting of key pcKey and value pvValue to oSymTable
+and sets *piInserted to 1 (TRUE). Either way it returns the address of
+the binding's value, through which the caller may read or change the
+value. The address stays valid until the next call that adds or
+removes a binding of oSymTable. If insufficient memory is available,
+then the function leaves oSymTable unchanged, sets *piInserted to 0
+(FALSE) and returns NULL. piInserted may be NULL. Inputs are
+SymTable_T oSymtable, const char *pcKey, const void *pvValue and
+int *piInserted */
+
+void **SymTable_findOrInsert(SymTable_T oSymTable, const char *pcKey,
+   const void *pvValue, int *piInserted);
+
+/*--------------------------------------------------------------------*/
+
+/* If oSymTable contains a binding with key pcKey, then SymTable_upsert
+replaces the binding's value with pvValue. Otherwise it adds a new
+binding consisting of key pcKey and value pvValue to oSymTable.
+Returns 1 (TRUE) on success. If insufficient memory is available, then
+the function leaves oSymTable unchanged and returns 0 (FALSE). Inputs
+are SymTable_T oSymtable, const char *pcKey, const void *pvValue */
+
+int SymTable_upsert(SymTable_T oSymTable, const char *pcKey,
+   const void *pvValue);
+
+/*--------------------------------------------------------------------*/
+
 /* SymTable_contains returns 1 (TRUE) if oSymTable contains a binding 
 whose key is pcKey, and 0 (FALSE) otherwise. Inputs are SymTable_T 
 oSymtable and const char *pcKey */
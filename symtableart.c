@@ -0,0 +1,1470 @@
+/*--------------------------------------------------------------------*/
+/* symtableart.c                                                      */
+/* Author: Angel Chang Liu                                            */
+/*--------------------------------------------------------------------*/
+
+#include "symtableordered.h"
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* The table is an adaptive radix tree. Each inner node branches on
+one byte of the key, and each key ends at a leaf that holds its value
+and the bytes of the key that the nodes above it do not. A key's
+terminating '\0' counts as one of its bytes, so no key is a prefix of
+another and every key has a leaf of its own. Inner nodes come in four
+sizes, which grow and shrink with their number of children. A chain
+of nodes with one child each is compressed into the path of the node
+below it, so a lookup touches about one node per distinguishing byte
+of the key, however many keys share its prefix, and never hashes or
+compares the whole key more than once. */
+
+/* number of path bytes stored in a node; a longer path is stored in a
+block of its own */
+enum {MAX_PREFIX_LENGTH = 10};
+
+/* the four sizes of inner node */
+enum {NODE4, NODE16, NODE48, NODE256};
+
+/* Header of an inner node */
+struct Node {
+   /* NODE4, NODE16, NODE48 or NODE256 */
+   unsigned char type;
+   /* Stores the number of children */
+   unsigned short numChildren;
+   /* Stores the number of key bytes that every key below the node
+   shares here before the node branches */
+   size_t prefixLength;
+   /* Those bytes, in the node if there are at most MAX_PREFIX_LENGTH
+   of them and otherwise in the block that pcLongPrefix points to */
+   union {
+      unsigned char acPrefix[MAX_PREFIX_LENGTH];
+      unsigned char *pcLongPrefix;
+   } uPrefix;
+};
+
+/* An inner node with up to 4 children, sorted by key byte */
+struct Node4 {
+   struct Node sNode;
+   unsigned char acKeys[4];
+   struct Node *apsChildren[4];
+};
+
+/* An inner node with up to 16 children, sorted by key byte */
+struct Node16 {
+   struct Node sNode;
+   unsigned char acKeys[16];
+   struct Node *apsChildren[16];
+};
+
+/* An inner node with up to 48 children. acChildIndex holds 1 plus the
+index in apsChildren of the child for each key byte, or 0. */
+struct Node48 {
+   struct Node sNode;
+   unsigned char acChildIndex[256];
+   struct Node *apsChildren[48];
+};
+
+/* An inner node with a child, or NULL, for every key byte */
+struct Node256 {
+   struct Node sNode;
+   struct Node *apsChildren[256];
+};
+
+/* Each key/value is stored in a Leaf. A pointer to a leaf is stored
+among the children of inner nodes with its lowest bit set. The depth
+of a leaf is the number of key bytes that the paths and key bytes of
+the nodes above it account for. */
+struct Leaf {
+   /* Data that is somehow pertinent to its key */
+   void *value;
+   /* The bytes of its key from the leaf's depth on, stored inline; ""
+   if the nodes above account for the whole key */
+   char key[];
+};
+
+/* Collection of key value pairs */
+struct SymTable {
+   /* The root of the tree: NULL, a tagged leaf or an inner node */
+   struct Node *psRoot;
+   /* Stores the number of bindings */
+   size_t numBindings;
+   /* A buffer in which scans rebuild keys, long enough for every key
+   that was added; NULL while a scan uses it */
+   char *pcKeyBuffer;
+   /* Stores the size of pcKeyBuffer */
+   size_t keyBufferSize;
+};
+
+/* The bounds and function of a SymTable_map, SymTable_mapRange or
+SymTable_mapPrefix call */
+struct Scan {
+   /* Keys less than pcLow are skipped, unless it is NULL */
+   const unsigned char *pcLow;
+   /* Stores the length of pcLow, counting its '\0' */
+   size_t lowLength;
+   /* Keys not less than pcHigh end the scan, unless it is NULL */
+   const char *pcHigh;
+   /* Keys that do not start with pcPrefix end the scan, unless it is
+   NULL */
+   const char *pcPrefix;
+   /* Stores the length of pcPrefix */
+   size_t prefixLength;
+   /* The function to apply to each binding and its extra parameter */
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra);
+   void *pvExtra;
+   /* Holds the key of the node or leaf being visited, up to its
+   depth */
+   char *pcKey;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Returns 1 (TRUE) if psNode is a tagged leaf, and 0 (FALSE) if it is
+an inner node. */
+
+static int SymTable_isLeaf(const struct Node *psNode) {
+   return ((uintptr_t)psNode & 1) != 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the leaf that the tagged pointer psNode refers to. */
+
+static struct Leaf *SymTable_leafOf(const struct Node *psNode) {
+   assert(SymTable_isLeaf(psNode));
+
+   return (struct Leaf*)(void*)((uintptr_t)psNode & ~(uintptr_t)1);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns psLeaf as a tagged pointer, to be stored as a child. */
+
+static struct Node *SymTable_tagLeaf(struct Leaf *psLeaf) {
+   assert(psLeaf != NULL);
+
+   return (struct Node*)(void*)((uintptr_t)psLeaf | 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a new leaf at byte depth of pcKey, whose length is
+keyLength counting its '\0', bound to pvValue, or NULL if insufficient
+memory is available. */
+
+static struct Leaf *SymTable_newLeaf(const char *pcKey,
+   size_t keyLength, size_t depth, const void *pvValue) {
+
+   struct Leaf *psLeaf;
+
+   assert(pcKey != NULL);
+   assert(depth <= keyLength);
+
+   if (depth == keyLength) {
+      psLeaf = (struct Leaf*)malloc(sizeof(struct Leaf) + 1);
+      if (psLeaf == NULL)
+         return NULL;
+      psLeaf->key[0] = '\0';
+   }
+   else {
+      psLeaf = (struct Leaf*)malloc(sizeof(struct Leaf) + keyLength
+         - depth);
+      if (psLeaf == NULL)
+         return NULL;
+      memcpy(psLeaf->key, pcKey + depth, keyLength - depth);
+   }
+   psLeaf->value = (void*)pvValue;
+   return psLeaf;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns 1 (TRUE) if the key of psLeaf, a leaf at byte depth of
+pcKey, is pcKey, whose length is keyLength counting its '\0', and 0
+(FALSE) otherwise. The bytes before depth are known to match. */
+
+static int SymTable_leafHasKey(const struct Leaf *psLeaf,
+   const char *pcKey, size_t keyLength, size_t depth) {
+
+   assert(psLeaf != NULL);
+   assert(pcKey != NULL);
+   assert(depth <= keyLength);
+
+   /* the nodes above may account for the '\0' too, which no other
+   key has there */
+   return depth == keyLength || strcmp(psLeaf->key, pcKey + depth) == 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Removes the first n bytes of the key of psLeaf, which moves down n
+bytes, and returns the leaf, which may have moved to a smaller
+block. */
+
+static struct Leaf *SymTable_dropLeafBytes(struct Leaf *psLeaf,
+   size_t n) {
+
+   struct Leaf *psSmallerLeaf;
+   size_t length;
+
+   assert(psLeaf != NULL);
+   assert(n > 0);
+
+   /* nothing is left if the dropped bytes end with the '\0' */
+   length = psLeaf->key[n - 1] == '\0' ? 0 : strlen(psLeaf->key + n);
+   memmove(psLeaf->key, psLeaf->key + n, length);
+   psLeaf->key[length] = '\0';
+
+   psSmallerLeaf = (struct Leaf*)realloc(psLeaf,
+      sizeof(struct Leaf) + length + 1);
+   return psSmallerLeaf != NULL ? psSmallerLeaf : psLeaf;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a new inner node of the given type with no children and an
+empty path, or NULL if insufficient memory is available. */
+
+static struct Node *SymTable_newNode(int type) {
+   struct Node *psNode;
+   size_t size;
+
+   switch (type) {
+      case NODE4:
+         size = sizeof(struct Node4);
+         break;
+      case NODE16:
+         size = sizeof(struct Node16);
+         break;
+      case NODE48:
+         size = sizeof(struct Node48);
+         break;
+      default:
+         size = sizeof(struct Node256);
+         break;
+   }
+
+   /* zeroed, so a Node48 has no child indexes and a Node256 no
+   children */
+   psNode = (struct Node*)calloc(1, size);
+   if (psNode == NULL)
+      return NULL;
+
+   psNode->type = (unsigned char)type;
+   return psNode;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Gives psDst the number of children and the path of psSrc. */
+
+static void SymTable_copyHeader(struct Node *psDst,
+   const struct Node *psSrc) {
+
+   assert(psDst != NULL);
+   assert(psSrc != NULL);
+
+   psDst->numChildren = psSrc->numChildren;
+   psDst->prefixLength = psSrc->prefixLength;
+   psDst->uPrefix = psSrc->uPrefix;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the index among the n sorted bytes of acKeys of the byte c,
+or n if c is not among them. */
+
+static size_t SymTable_findByte(const unsigned char *acKeys, size_t n,
+   unsigned char c) {
+
+   size_t i;
+
+   assert(acKeys != NULL);
+
+#ifdef __SSE2__
+   /* compare all 16 bytes of a Node16 at once */
+   if (n > 4) {
+      unsigned uMatches = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(
+         _mm_loadu_si128((const __m128i*)(const void*)acKeys),
+         _mm_set1_epi8((char)c))) & ((1U << n) - 1);
+      if (uMatches == 0)
+         return n;
+      for (i = 0; (uMatches & 1U) == 0; i++)
+         uMatches >>= 1;
+      return i;
+   }
+#endif
+
+   for (i = 0; i < n; i++)
+      if (acKeys[i] == c)
+         return i;
+   return n;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the address of the child of the inner node psNode for key
+byte c, or NULL if it has none. */
+
+static struct Node **SymTable_findChild(struct Node *psNode,
+   unsigned char c) {
+
+   struct Node4 *psNode4;
+   struct Node16 *psNode16;
+   struct Node48 *psNode48;
+   struct Node256 *psNode256;
+   size_t i;
+
+   assert(psNode != NULL);
+   assert(! SymTable_isLeaf(psNode));
+
+   switch (psNode->type) {
+      case NODE4:
+         psNode4 = (struct Node4*)psNode;
+         i = SymTable_findByte(psNode4->acKeys, psNode->numChildren, c);
+         return i < psNode->numChildren ?
+            &psNode4->apsChildren[i] : NULL;
+      case NODE16:
+         psNode16 = (struct Node16*)psNode;
+         i = SymTable_findByte(psNode16->acKeys, psNode->numChildren,
+            c);
+         return i < psNode->numChildren ?
+            &psNode16->apsChildren[i] : NULL;
+      case NODE48:
+         psNode48 = (struct Node48*)psNode;
+         i = psNode48->acChildIndex[c];
+         return i != 0 ? &psNode48->apsChildren[i - 1] : NULL;
+      default:
+         psNode256 = (struct Node256*)psNode;
+         return psNode256->apsChildren[c] != NULL ?
+            &psNode256->apsChildren[c] : NULL;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the path of the inner node psNode. */
+
+static const unsigned char *SymTable_prefix(const struct Node *psNode) {
+   assert(psNode != NULL);
+
+   if (psNode->prefixLength <= MAX_PREFIX_LENGTH)
+      return psNode->uPrefix.acPrefix;
+   return psNode->uPrefix.pcLongPrefix;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Frees the block that holds the path of the inner node psNode, if it
+has one. */
+
+static void SymTable_freePrefix(struct Node *psNode) {
+   assert(psNode != NULL);
+
+   if (psNode->prefixLength > MAX_PREFIX_LENGTH)
+      free(psNode->uPrefix.pcLongPrefix);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Gives the inner node psNode, which has no block of its own for its
+path, the path of the length bytes at pcPrefix. Returns 1 (TRUE) on
+success, or 0 (FALSE), leaving psNode unchanged, if insufficient
+memory is available. */
+
+static int SymTable_setPrefix(struct Node *psNode,
+   const unsigned char *pcPrefix, size_t length) {
+
+   unsigned char *pcLongPrefix;
+
+   assert(psNode != NULL);
+   assert(pcPrefix != NULL || length == 0);
+
+   if (length <= MAX_PREFIX_LENGTH)
+      memcpy(psNode->uPrefix.acPrefix, pcPrefix, length);
+   else {
+      pcLongPrefix = (unsigned char*)malloc(length);
+      if (pcLongPrefix == NULL)
+         return 0;
+      memcpy(pcLongPrefix, pcPrefix, length);
+      psNode->uPrefix.pcLongPrefix = pcLongPrefix;
+   }
+   psNode->prefixLength = length;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Removes the first n bytes of the path of the inner node psNode. */
+
+static void SymTable_dropPrefix(struct Node *psNode, size_t n) {
+   unsigned char *pcLongPrefix;
+   size_t length;
+
+   assert(psNode != NULL);
+   assert(n <= psNode->prefixLength);
+
+   length = psNode->prefixLength - n;
+   if (psNode->prefixLength <= MAX_PREFIX_LENGTH)
+      memmove(psNode->uPrefix.acPrefix, psNode->uPrefix.acPrefix + n,
+         length);
+   else {
+      /* a path that becomes short moves into the node */
+      pcLongPrefix = psNode->uPrefix.pcLongPrefix;
+      if (length <= MAX_PREFIX_LENGTH) {
+         memcpy(psNode->uPrefix.acPrefix, pcLongPrefix + n, length);
+         free(pcLongPrefix);
+      }
+      else
+         memmove(pcLongPrefix, pcLongPrefix + n, length);
+   }
+   psNode->prefixLength = length;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns how many bytes of the path of the inner node psNode, which
+is reached at byte depth, match the bytes of pcKey, whose length is
+keyLength, from depth on. At most keyLength - depth bytes are
+compared. */
+
+static size_t SymTable_prefixMismatch(const struct Node *psNode,
+   const unsigned char *pcKey, size_t keyLength, size_t depth) {
+
+   const unsigned char *pcPrefix;
+   size_t maxCompare;
+   size_t i;
+
+   assert(psNode != NULL);
+   assert(pcKey != NULL);
+   assert(depth <= keyLength);
+
+   maxCompare = psNode->prefixLength;
+   if (maxCompare > keyLength - depth)
+      maxCompare = keyLength - depth;
+
+   pcPrefix = SymTable_prefix(psNode);
+   for (i = 0; i < maxCompare; i++)
+      if (pcPrefix[i] != pcKey[depth + i])
+         break;
+   return i;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The following functions add psChild as the child for key byte c to
+the inner node *ppsRef of their type, which has no child for c. A full
+node is first replaced by a bigger one. Each returns 1 (TRUE) on
+success, or 0 (FALSE) and leaves the node unchanged if insufficient
+memory is available. */
+
+static int SymTable_addChild256(struct Node **ppsRef, unsigned char c,
+   struct Node *psChild) {
+
+   struct Node256 *psNode256 = (struct Node256*)*ppsRef;
+
+   psNode256->apsChildren[c] = psChild;
+   psNode256->sNode.numChildren++;
+   return 1;
+}
+
+static int SymTable_addChild48(struct Node **ppsRef, unsigned char c,
+   struct Node *psChild) {
+
+   struct Node48 *psNode48 = (struct Node48*)*ppsRef;
+   struct Node256 *psNode256;
+   size_t i;
+
+   if (psNode48->sNode.numChildren < 48) {
+      for (i = 0; psNode48->apsChildren[i] != NULL; i++)
+         ;
+      psNode48->apsChildren[i] = psChild;
+      psNode48->acChildIndex[c] = (unsigned char)(i + 1);
+      psNode48->sNode.numChildren++;
+      return 1;
+   }
+
+   psNode256 = (struct Node256*)SymTable_newNode(NODE256);
+   if (psNode256 == NULL)
+      return 0;
+   SymTable_copyHeader(&psNode256->sNode, &psNode48->sNode);
+   for (i = 0; i < 256; i++)
+      if (psNode48->acChildIndex[i] != 0)
+         psNode256->apsChildren[i] =
+            psNode48->apsChildren[psNode48->acChildIndex[i] - 1];
+   *ppsRef = &psNode256->sNode;
+   free(psNode48);
+   return SymTable_addChild256(ppsRef, c, psChild);
+}
+
+static int SymTable_addChild16(struct Node **ppsRef, unsigned char c,
+   struct Node *psChild) {
+
+   struct Node16 *psNode16 = (struct Node16*)*ppsRef;
+   struct Node48 *psNode48;
+   size_t n = psNode16->sNode.numChildren;
+   size_t i;
+
+   if (n < 16) {
+      for (i = 0; i < n && psNode16->acKeys[i] < c; i++)
+         ;
+      memmove(&psNode16->acKeys[i + 1], &psNode16->acKeys[i], n - i);
+      memmove(&psNode16->apsChildren[i + 1], &psNode16->apsChildren[i],
+         (n - i) * sizeof(struct Node*));
+      psNode16->acKeys[i] = c;
+      psNode16->apsChildren[i] = psChild;
+      psNode16->sNode.numChildren++;
+      return 1;
+   }
+
+   psNode48 = (struct Node48*)SymTable_newNode(NODE48);
+   if (psNode48 == NULL)
+      return 0;
+   SymTable_copyHeader(&psNode48->sNode, &psNode16->sNode);
+   for (i = 0; i < n; i++) {
+      psNode48->apsChildren[i] = psNode16->apsChildren[i];
+      psNode48->acChildIndex[psNode16->acKeys[i]] =
+         (unsigned char)(i + 1);
+   }
+   *ppsRef = &psNode48->sNode;
+   free(psNode16);
+   return SymTable_addChild48(ppsRef, c, psChild);
+}
+
+static int SymTable_addChild4(struct Node **ppsRef, unsigned char c,
+   struct Node *psChild) {
+
+   struct Node4 *psNode4 = (struct Node4*)*ppsRef;
+   struct Node16 *psNode16;
+   size_t n = psNode4->sNode.numChildren;
+   size_t i;
+
+   if (n < 4) {
+      for (i = 0; i < n && psNode4->acKeys[i] < c; i++)
+         ;
+      memmove(&psNode4->acKeys[i + 1], &psNode4->acKeys[i], n - i);
+      memmove(&psNode4->apsChildren[i + 1], &psNode4->apsChildren[i],
+         (n - i) * sizeof(struct Node*));
+      psNode4->acKeys[i] = c;
+      psNode4->apsChildren[i] = psChild;
+      psNode4->sNode.numChildren++;
+      return 1;
+   }
+
+   psNode16 = (struct Node16*)SymTable_newNode(NODE16);
+   if (psNode16 == NULL)
+      return 0;
+   SymTable_copyHeader(&psNode16->sNode, &psNode4->sNode);
+   memcpy(psNode16->acKeys, psNode4->acKeys, n);
+   memcpy(psNode16->apsChildren, psNode4->apsChildren,
+      n * sizeof(struct Node*));
+   *ppsRef = &psNode16->sNode;
+   free(psNode4);
+   return SymTable_addChild16(ppsRef, c, psChild);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Adds psChild as the child for key byte c to the inner node *ppsRef,
+which has no child for c, replacing *ppsRef by a bigger node if it is
+full. Returns 1 (TRUE) on success, or 0 (FALSE) and leaves the node
+unchanged if insufficient memory is available. */
+
+static int SymTable_addChild(struct Node **ppsRef, unsigned char c,
+   struct Node *psChild) {
+
+   assert(ppsRef != NULL);
+   assert(*ppsRef != NULL);
+   assert(psChild != NULL);
+
+   switch ((*ppsRef)->type) {
+      case NODE4:
+         return SymTable_addChild4(ppsRef, c, psChild);
+      case NODE16:
+         return SymTable_addChild16(ppsRef, c, psChild);
+      case NODE48:
+         return SymTable_addChild48(ppsRef, c, psChild);
+      default:
+         return SymTable_addChild256(ppsRef, c, psChild);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The following functions remove the child *ppsChild, for key byte
+c, from the inner node *ppsRef of their type. A node left with few
+children is replaced by a smaller one, and a Node4 left with one child
+is merged into that child, when memory allows. */
+
+static void SymTable_removeChild256(struct Node **ppsRef,
+   unsigned char c) {
+
+   struct Node256 *psNode256 = (struct Node256*)*ppsRef;
+   struct Node48 *psNode48;
+   size_t i;
+   size_t n = 0;
+
+   psNode256->apsChildren[c] = NULL;
+   psNode256->sNode.numChildren--;
+
+   /* shrink well below 48 children, so that a node does not keep
+   growing and shrinking */
+   if (psNode256->sNode.numChildren != 37)
+      return;
+   psNode48 = (struct Node48*)SymTable_newNode(NODE48);
+   if (psNode48 == NULL)
+      return;
+   SymTable_copyHeader(&psNode48->sNode, &psNode256->sNode);
+   for (i = 0; i < 256; i++)
+      if (psNode256->apsChildren[i] != NULL) {
+         psNode48->apsChildren[n] = psNode256->apsChildren[i];
+         psNode48->acChildIndex[i] = (unsigned char)(n + 1);
+         n++;
+      }
+   *ppsRef = &psNode48->sNode;
+   free(psNode256);
+}
+
+static void SymTable_removeChild48(struct Node **ppsRef,
+   unsigned char c) {
+
+   struct Node48 *psNode48 = (struct Node48*)*ppsRef;
+   struct Node16 *psNode16;
+   size_t i;
+   size_t n = 0;
+
+   psNode48->apsChildren[psNode48->acChildIndex[c] - 1] = NULL;
+   psNode48->acChildIndex[c] = 0;
+   psNode48->sNode.numChildren--;
+
+   if (psNode48->sNode.numChildren != 12)
+      return;
+   psNode16 = (struct Node16*)SymTable_newNode(NODE16);
+   if (psNode16 == NULL)
+      return;
+   SymTable_copyHeader(&psNode16->sNode, &psNode48->sNode);
+   for (i = 0; i < 256; i++)
+      if (psNode48->acChildIndex[i] != 0) {
+         psNode16->acKeys[n] = (unsigned char)i;
+         psNode16->apsChildren[n] =
+            psNode48->apsChildren[psNode48->acChildIndex[i] - 1];
+         n++;
+      }
+   *ppsRef = &psNode16->sNode;
+   free(psNode48);
+}
+
+static void SymTable_removeChild16(struct Node **ppsRef,
+   struct Node **ppsChild) {
+
+   struct Node16 *psNode16 = (struct Node16*)*ppsRef;
+   struct Node4 *psNode4;
+   size_t i = (size_t)(ppsChild - psNode16->apsChildren);
+   size_t n = psNode16->sNode.numChildren;
+
+   memmove(&psNode16->acKeys[i], &psNode16->acKeys[i + 1], n - i - 1);
+   memmove(&psNode16->apsChildren[i], &psNode16->apsChildren[i + 1],
+      (n - i - 1) * sizeof(struct Node*));
+   psNode16->sNode.numChildren--;
+
+   if (psNode16->sNode.numChildren != 3)
+      return;
+   psNode4 = (struct Node4*)SymTable_newNode(NODE4);
+   if (psNode4 == NULL)
+      return;
+   SymTable_copyHeader(&psNode4->sNode, &psNode16->sNode);
+   memcpy(psNode4->acKeys, psNode16->acKeys, 3);
+   memcpy(psNode4->apsChildren, psNode16->apsChildren,
+      3 * sizeof(struct Node*));
+   *ppsRef = &psNode4->sNode;
+   free(psNode16);
+}
+
+static void SymTable_removeChild4(struct Node **ppsRef,
+   struct Node **ppsChild) {
+
+   struct Node4 *psNode4 = (struct Node4*)*ppsRef;
+   struct Node *psChild;
+   struct Leaf *psLeaf;
+   struct Leaf *psNewLeaf;
+   unsigned char acPrefix[MAX_PREFIX_LENGTH];
+   unsigned char *pcPrefix;
+   size_t i = (size_t)(ppsChild - psNode4->apsChildren);
+   size_t n = psNode4->sNode.numChildren;
+   size_t prefixLength = psNode4->sNode.prefixLength;
+   size_t suffixLength;
+   size_t length;
+
+   memmove(&psNode4->acKeys[i], &psNode4->acKeys[i + 1], n - i - 1);
+   memmove(&psNode4->apsChildren[i], &psNode4->apsChildren[i + 1],
+      (n - i - 1) * sizeof(struct Node*));
+   psNode4->sNode.numChildren--;
+
+   if (psNode4->sNode.numChildren != 1)
+      return;
+
+   /* The only child takes the node's place. A leaf moves up to the
+   node's depth, so its key gains the node's path and the key byte of
+   the leaf. */
+   psChild = psNode4->apsChildren[0];
+   if (SymTable_isLeaf(psChild)) {
+      psLeaf = SymTable_leafOf(psChild);
+      suffixLength = psNode4->acKeys[0] == '\0' ? 0 :
+         strlen(psLeaf->key) + 1;
+      psNewLeaf = (struct Leaf*)malloc(sizeof(struct Leaf) +
+         prefixLength + 1 + suffixLength);
+      if (psNewLeaf == NULL)
+         return;
+      psNewLeaf->value = psLeaf->value;
+      memcpy(psNewLeaf->key, SymTable_prefix(&psNode4->sNode),
+         prefixLength);
+      psNewLeaf->key[prefixLength] = (char)psNode4->acKeys[0];
+      memcpy(psNewLeaf->key + prefixLength + 1, psLeaf->key,
+         suffixLength);
+      free(psLeaf);
+      psChild = SymTable_tagLeaf(psNewLeaf);
+   }
+
+   /* An inner child's path becomes the node's path, then the key byte
+   of the child, then its own path. */
+   else {
+      length = prefixLength + 1 + psChild->prefixLength;
+      if (length <= MAX_PREFIX_LENGTH)
+         pcPrefix = acPrefix;
+      else {
+         pcPrefix = (unsigned char*)malloc(length);
+         if (pcPrefix == NULL)
+            return;
+      }
+      memcpy(pcPrefix, SymTable_prefix(&psNode4->sNode), prefixLength);
+      pcPrefix[prefixLength] = psNode4->acKeys[0];
+      memcpy(pcPrefix + prefixLength + 1, SymTable_prefix(psChild),
+         psChild->prefixLength);
+      SymTable_freePrefix(psChild);
+      if (length <= MAX_PREFIX_LENGTH)
+         memcpy(psChild->uPrefix.acPrefix, acPrefix, length);
+      else
+         psChild->uPrefix.pcLongPrefix = pcPrefix;
+      psChild->prefixLength = length;
+   }
+   SymTable_freePrefix(&psNode4->sNode);
+   *ppsRef = psChild;
+   free(psNode4);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Removes the child *ppsChild, for key byte c, from the inner node
+*ppsRef, which may be replaced by a smaller node or by its only
+remaining child. */
+
+static void SymTable_removeChild(struct Node **ppsRef, unsigned char c,
+   struct Node **ppsChild) {
+
+   assert(ppsRef != NULL);
+   assert(*ppsRef != NULL);
+   assert(ppsChild != NULL);
+
+   switch ((*ppsRef)->type) {
+      case NODE4:
+         SymTable_removeChild4(ppsRef, ppsChild);
+         break;
+      case NODE16:
+         SymTable_removeChild16(ppsRef, ppsChild);
+         break;
+      case NODE48:
+         SymTable_removeChild48(ppsRef, c);
+         break;
+      default:
+         SymTable_removeChild256(ppsRef, c);
+         break;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Frees the subtree psNode, which may be NULL or a tagged leaf. */
+
+static void SymTable_freeNode(struct Node *psNode) {
+   struct Node4 *psNode4;
+   struct Node16 *psNode16;
+   struct Node48 *psNode48;
+   struct Node256 *psNode256;
+   size_t i;
+
+   if (psNode == NULL)
+      return;
+   if (SymTable_isLeaf(psNode)) {
+      free(SymTable_leafOf(psNode));
+      return;
+   }
+
+   switch (psNode->type) {
+      case NODE4:
+         psNode4 = (struct Node4*)psNode;
+         for (i = 0; i < psNode->numChildren; i++)
+            SymTable_freeNode(psNode4->apsChildren[i]);
+         break;
+      case NODE16:
+         psNode16 = (struct Node16*)psNode;
+         for (i = 0; i < psNode->numChildren; i++)
+            SymTable_freeNode(psNode16->apsChildren[i]);
+         break;
+      case NODE48:
+         psNode48 = (struct Node48*)psNode;
+         for (i = 0; i < 48; i++)
+            SymTable_freeNode(psNode48->apsChildren[i]);
+         break;
+      default:
+         psNode256 = (struct Node256*)psNode;
+         for (i = 0; i < 256; i++)
+            SymTable_freeNode(psNode256->apsChildren[i]);
+         break;
+   }
+   SymTable_freePrefix(psNode);
+   free(psNode);
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_new(void) {
+   SymTable_T oSymTable;
+
+   /* allocate new memory */
+   oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
+   if (oSymTable == NULL)
+      return NULL;
+
+   oSymTable->psRoot = NULL;
+   oSymTable->numBindings = 0;
+   oSymTable->pcKeyBuffer = NULL;
+   oSymTable->keyBufferSize = 0;
+   return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_free(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+
+   SymTable_freeNode(oSymTable->psRoot);
+   free(oSymTable->pcKeyBuffer);
+   free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getLength(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+
+   return oSymTable->numBindings;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the leaf of oSymTable whose key is pcKey, or NULL if there
+is no such leaf. The paths and the branching bytes are checked on the
+way down, and the rest of the key against the leaf at the end. */
+
+static struct Leaf *SymTable_lookup(SymTable_T oSymTable,
+   const char *pcKey) {
+
+   const unsigned char *pcBytes = (const unsigned char*)pcKey;
+   struct Node *psNode;
+   struct Node **ppsChild;
+   struct Leaf *psLeaf;
+   size_t keyLength;
+   size_t depth = 0;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   /* the '\0' is the last byte of the key */
+   keyLength = strlen(pcKey) + 1;
+
+   psNode = oSymTable->psRoot;
+   while (psNode != NULL) {
+      if (SymTable_isLeaf(psNode)) {
+         psLeaf = SymTable_leafOf(psNode);
+         if (SymTable_leafHasKey(psLeaf, pcKey, keyLength, depth))
+            return psLeaf;
+         return NULL;
+      }
+
+      if (psNode->prefixLength > 0) {
+         if (depth + psNode->prefixLength > keyLength ||
+            memcmp(SymTable_prefix(psNode), pcBytes + depth,
+               psNode->prefixLength) != 0)
+            return NULL;
+         depth += psNode->prefixLength;
+      }
+      if (depth >= keyLength)
+         return NULL;
+
+      ppsChild = SymTable_findChild(psNode, pcBytes[depth]);
+      psNode = ppsChild != NULL ? *ppsChild : NULL;
+      depth++;
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the leaf of the subtree *ppsRef, reached at byte depth of
+pcKey, whose key is pcKey, and sets *piInserted to 0 (FALSE). If there
+is no such leaf, adds one of pcKey to pvValue, returns it and sets
+*piInserted to 1 (TRUE). keyLength is the length of pcKey, counting
+its '\0'. If insufficient memory is available, leaves the subtree's
+bindings unchanged and returns NULL. */
+
+static struct Leaf *SymTable_findOrAdd(struct Node **ppsRef,
+   const char *pcKey, size_t keyLength, size_t depth,
+   const void *pvValue, int *piInserted) {
+
+   const unsigned char *pcBytes = (const unsigned char*)pcKey;
+   struct Node *psNode;
+   struct Node *psNewNode;
+   struct Node **ppsChild;
+   struct Leaf *psLeaf;
+   struct Leaf *psNewLeaf;
+   unsigned char c;
+   size_t common;
+
+   assert(ppsRef != NULL);
+   assert(pcKey != NULL);
+   assert(piInserted != NULL);
+
+   for (;;) {
+      psNode = *ppsRef;
+
+      /* an empty place takes the new leaf */
+      if (psNode == NULL) {
+         psNewLeaf = SymTable_newLeaf(pcKey, keyLength, depth, pvValue);
+         if (psNewLeaf == NULL)
+            return NULL;
+         *ppsRef = SymTable_tagLeaf(psNewLeaf);
+         *piInserted = 1;
+         return psNewLeaf;
+      }
+
+      /* a leaf with another key is split from the new one by a Node4
+      whose path is what the two keys share */
+      if (SymTable_isLeaf(psNode)) {
+         psLeaf = SymTable_leafOf(psNode);
+         if (SymTable_leafHasKey(psLeaf, pcKey, keyLength, depth))
+            return psLeaf;
+
+         for (common = 0; (unsigned char)psLeaf->key[common] ==
+            pcBytes[depth + common]; common++)
+            ;
+         psNewNode = SymTable_newNode(NODE4);
+         if (psNewNode == NULL)
+            return NULL;
+         if (! SymTable_setPrefix(psNewNode, pcBytes + depth, common)) {
+            free(psNewNode);
+            return NULL;
+         }
+         psNewLeaf = SymTable_newLeaf(pcKey, keyLength,
+            depth + common + 1, pvValue);
+         if (psNewLeaf == NULL) {
+            SymTable_freePrefix(psNewNode);
+            free(psNewNode);
+            return NULL;
+         }
+         c = (unsigned char)psLeaf->key[common];
+         psLeaf = SymTable_dropLeafBytes(psLeaf, common + 1);
+         (void)SymTable_addChild(&psNewNode, c,
+            SymTable_tagLeaf(psLeaf));
+         (void)SymTable_addChild(&psNewNode, pcBytes[depth + common],
+            SymTable_tagLeaf(psNewLeaf));
+         *ppsRef = psNewNode;
+         *piInserted = 1;
+         return psNewLeaf;
+      }
+
+      /* a path that the key leaves part way is split by a Node4 at the
+      point where they differ */
+      if (psNode->prefixLength > 0) {
+         common = SymTable_prefixMismatch(psNode, pcBytes, keyLength,
+            depth);
+         if (common < psNode->prefixLength) {
+            psNewNode = SymTable_newNode(NODE4);
+            if (psNewNode == NULL)
+               return NULL;
+            if (! SymTable_setPrefix(psNewNode, SymTable_prefix(psNode),
+               common)) {
+               free(psNewNode);
+               return NULL;
+            }
+            psNewLeaf = SymTable_newLeaf(pcKey, keyLength,
+               depth + common + 1, pvValue);
+            if (psNewLeaf == NULL) {
+               SymTable_freePrefix(psNewNode);
+               free(psNewNode);
+               return NULL;
+            }
+
+            /* the old node keeps the rest of its path */
+            c = SymTable_prefix(psNode)[common];
+            SymTable_dropPrefix(psNode, common + 1);
+            (void)SymTable_addChild(&psNewNode, c, psNode);
+            (void)SymTable_addChild(&psNewNode, pcBytes[depth + common],
+               SymTable_tagLeaf(psNewLeaf));
+            *ppsRef = psNewNode;
+            *piInserted = 1;
+            return psNewLeaf;
+         }
+         depth += psNode->prefixLength;
+      }
+
+      /* follow the child for the next byte, or add the leaf there */
+      ppsChild = SymTable_findChild(psNode, pcBytes[depth]);
+      if (ppsChild == NULL) {
+         psNewLeaf = SymTable_newLeaf(pcKey, keyLength, depth + 1,
+            pvValue);
+         if (psNewLeaf == NULL)
+            return NULL;
+         if (! SymTable_addChild(ppsRef, pcBytes[depth],
+            SymTable_tagLeaf(psNewLeaf))) {
+            free(psNewLeaf);
+            return NULL;
+         }
+         *piInserted = 1;
+         return psNewLeaf;
+      }
+      ppsRef = ppsChild;
+      depth++;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Finds or adds the binding of pcKey in oSymTable as
+SymTable_findOrAdd does for the whole tree, and counts a new
+binding. */
+
+static struct Leaf *SymTable_findOrAddKey(SymTable_T oSymTable,
+   const char *pcKey, const void *pvValue, int *piInserted) {
+
+   struct Leaf *psLeaf;
+   char *pcKeyBuffer;
+   size_t keyLength;
+   size_t size;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(piInserted != NULL);
+
+   *piInserted = 0;
+   keyLength = strlen(pcKey) + 1;
+
+   /* scans rebuild keys in the buffer, and may write one byte past
+   the '\0' of a key whose leaf holds "" */
+   if (keyLength + 1 > oSymTable->keyBufferSize) {
+      size = 2 * oSymTable->keyBufferSize;
+      if (size < keyLength + 1)
+         size = keyLength + 1;
+      pcKeyBuffer = (char*)realloc(oSymTable->pcKeyBuffer, size);
+      if (pcKeyBuffer == NULL)
+         return NULL;
+      oSymTable->pcKeyBuffer = pcKeyBuffer;
+      oSymTable->keyBufferSize = size;
+   }
+
+   psLeaf = SymTable_findOrAdd(&oSymTable->psRoot, pcKey, keyLength,
+      0, pvValue, piInserted);
+   if (*piInserted)
+      oSymTable->numBindings++;
+   return psLeaf;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_put(SymTable_T oSymTable,
+   const char *pcKey, const void *pvValue) {
+
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   (void)SymTable_findOrAddKey(oSymTable, pcKey, pvValue, &iInserted);
+   return iInserted;
+}
+
+/*--------------------------------------------------------------------*/
+
+void **SymTable_findOrInsert(SymTable_T oSymTable, const char *pcKey,
+   const void *pvValue, int *piInserted) {
+
+   struct Leaf *psLeaf;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   psLeaf = SymTable_findOrAddKey(oSymTable, pcKey, pvValue,
+      &iInserted);
+   if (piInserted != NULL)
+      *piInserted = iInserted;
+   if (psLeaf == NULL)
+      return NULL;
+
+   return &psLeaf->value;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_upsert(SymTable_T oSymTable, const char *pcKey,
+   const void *pvValue) {
+
+   struct Leaf *psLeaf;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   /* one descent either finds the binding or adds it */
+   psLeaf = SymTable_findOrAddKey(oSymTable, pcKey, pvValue,
+      &iInserted);
+   if (psLeaf == NULL)
+      return 0;
+
+   psLeaf->value = (void*)pvValue;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_replace(SymTable_T oSymTable,
+   const char *pcKey, const void *pvValue) {
+
+   void *temp;
+   struct Leaf *psLeaf;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   psLeaf = SymTable_lookup(oSymTable, pcKey);
+   if (psLeaf == NULL)
+      return NULL;
+
+   temp = psLeaf->value;
+   psLeaf->value = (void*)pvValue;
+   return temp;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   return SymTable_lookup(oSymTable, pcKey) != NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+   struct Leaf *psLeaf;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   psLeaf = SymTable_lookup(oSymTable, pcKey);
+   if (psLeaf == NULL)
+      return NULL;
+
+   return psLeaf->value;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+   const unsigned char *pcBytes = (const unsigned char*)pcKey;
+   struct Node **ppsRef;
+   struct Node **ppsChild;
+   struct Node *psNode;
+   struct Leaf *psLeaf;
+   void *temp;
+   size_t keyLength;
+   size_t depth = 0;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   keyLength = strlen(pcKey) + 1;
+
+   /* a lone leaf at the root */
+   psNode = oSymTable->psRoot;
+   if (psNode == NULL)
+      return NULL;
+   if (SymTable_isLeaf(psNode)) {
+      psLeaf = SymTable_leafOf(psNode);
+      if (! SymTable_leafHasKey(psLeaf, pcKey, keyLength, 0))
+         return NULL;
+      oSymTable->psRoot = NULL;
+      temp = psLeaf->value;
+      free(psLeaf);
+      oSymTable->numBindings--;
+      return temp;
+   }
+
+   /* find the inner node whose child is the leaf */
+   ppsRef = &oSymTable->psRoot;
+   for (;;) {
+      psNode = *ppsRef;
+      if (psNode->prefixLength > 0) {
+         if (depth + psNode->prefixLength > keyLength ||
+            memcmp(SymTable_prefix(psNode), pcBytes + depth,
+               psNode->prefixLength) != 0)
+            return NULL;
+         depth += psNode->prefixLength;
+      }
+      if (depth >= keyLength)
+         return NULL;
+
+      ppsChild = SymTable_findChild(psNode, pcBytes[depth]);
+      if (ppsChild == NULL)
+         return NULL;
+      if (SymTable_isLeaf(*ppsChild))
+         break;
+      ppsRef = ppsChild;
+      depth++;
+   }
+
+   psLeaf = SymTable_leafOf(*ppsChild);
+   if (! SymTable_leafHasKey(psLeaf, pcKey, keyLength, depth + 1))
+      return NULL;
+
+   SymTable_removeChild(ppsRef, pcBytes[depth], ppsChild);
+   temp = psLeaf->value;
+   free(psLeaf);
+   oSymTable->numBindings--;
+   return temp;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns 1 (TRUE) if pcKey lies past the end of the scan *psScan,
+and 0 (FALSE) otherwise. */
+
+static int SymTable_pastEnd(const struct Scan *psScan,
+   const char *pcKey) {
+
+   assert(psScan != NULL);
+   assert(pcKey != NULL);
+
+   if (psScan->pcHigh != NULL && strcmp(pcKey, psScan->pcHigh) >= 0)
+      return 1;
+   if (psScan->pcPrefix != NULL &&
+      strncmp(pcKey, psScan->pcPrefix, psScan->prefixLength) != 0)
+      return 1;
+   return 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Applies the function of *psScan to the bindings of the subtree
+psNode, which is reached at byte depth, in key order. If onLow is
+nonzero (TRUE), the keys of the subtree agree with psScan->pcLow up to
+depth, and subtrees of keys less than pcLow are skipped. Returns 1
+(TRUE) once a key past the end of the scan is reached, and 0 (FALSE)
+otherwise. */
+
+static int SymTable_scanNode(const struct Node *psNode, size_t depth,
+   int onLow, const struct Scan *psScan) {
+
+   const struct Node4 *psNode4;
+   const struct Node16 *psNode16;
+   const struct Node48 *psNode48;
+   const struct Node256 *psNode256;
+   const struct Node *psChild;
+   const struct Leaf *psLeaf;
+   unsigned char cLow = 0;
+   size_t common;
+   size_t c;
+   size_t n;
+
+   assert(psScan != NULL);
+
+   if (psNode == NULL)
+      return 0;
+
+   /* a leaf completes the key that the nodes above it began */
+   if (SymTable_isLeaf(psNode)) {
+      psLeaf = SymTable_leafOf(psNode);
+      strcpy(psScan->pcKey + depth, psLeaf->key);
+      if (onLow &&
+         strcmp(psScan->pcKey, (const char*)psScan->pcLow) < 0)
+         return 0;
+      if (SymTable_pastEnd(psScan, psScan->pcKey))
+         return 1;
+      (*psScan->pfApply)(psScan->pcKey, psLeaf->value,
+         psScan->pvExtra);
+      return 0;
+   }
+
+   /* a path that leaves pcLow puts the whole subtree below or above
+   it */
+   if (onLow && psNode->prefixLength > 0) {
+      common = SymTable_prefixMismatch(psNode, psScan->pcLow,
+         psScan->lowLength, depth);
+      if (common < psNode->prefixLength) {
+         if (SymTable_prefix(psNode)[common] <
+            psScan->pcLow[depth + common])
+            return 0;
+         onLow = 0;
+      }
+   }
+   memcpy(psScan->pcKey + depth, SymTable_prefix(psNode),
+      psNode->prefixLength);
+   depth += psNode->prefixLength;
+   if (onLow)
+      cLow = psScan->pcLow[depth];
+
+   /* visit the children in order of their key bytes, from cLow */
+   n = psNode->numChildren;
+   for (c = 0; c < 256; c++) {
+      switch (psNode->type) {
+         case NODE4:
+            psNode4 = (const struct Node4*)psNode;
+            if (c >= n)
+               return 0;
+            psChild = psNode4->apsChildren[c];
+            if (onLow && psNode4->acKeys[c] < cLow)
+               continue;
+            psScan->pcKey[depth] = (char)psNode4->acKeys[c];
+            if (SymTable_scanNode(psChild, depth + 1,
+               onLow && psNode4->acKeys[c] == cLow, psScan))
+               return 1;
+            break;
+         case NODE16:
+            psNode16 = (const struct Node16*)psNode;
+            if (c >= n)
+               return 0;
+            psChild = psNode16->apsChildren[c];
+            if (onLow && psNode16->acKeys[c] < cLow)
+               continue;
+            psScan->pcKey[depth] = (char)psNode16->acKeys[c];
+            if (SymTable_scanNode(psChild, depth + 1,
+               onLow && psNode16->acKeys[c] == cLow, psScan))
+               return 1;
+            break;
+         case NODE48:
+            psNode48 = (const struct Node48*)psNode;
+            if ((onLow && c < cLow) || psNode48->acChildIndex[c] == 0)
+               continue;
+            psChild =
+               psNode48->apsChildren[psNode48->acChildIndex[c] - 1];
+            psScan->pcKey[depth] = (char)c;
+            if (SymTable_scanNode(psChild, depth + 1,
+               onLow && c == cLow, psScan))
+               return 1;
+            break;
+         default:
+            psNode256 = (const struct Node256*)psNode;
+            if ((onLow && c < cLow) ||
+               psNode256->apsChildren[c] == NULL)
+               continue;
+            psScan->pcKey[depth] = (char)c;
+            if (SymTable_scanNode(psNode256->apsChildren[c], depth + 1,
+               onLow && c == cLow, psScan))
+               return 1;
+            break;
+      }
+   }
+   return 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Applies pfApply to the bindings of oSymTable from pcLow on, in key
+order, until one past the end given by pcHigh or pcPrefix, as
+described in symtableordered.h. */
+
+static void SymTable_scan(SymTable_T oSymTable, const char *pcLow,
+   const char *pcHigh, const char *pcPrefix,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+
+   struct Scan sScan;
+
+   assert(oSymTable != NULL);
+   assert(pfApply != NULL);
+
+   sScan.pcLow = (const unsigned char*)pcLow;
+   sScan.lowLength = pcLow == NULL ? 0 : strlen(pcLow) + 1;
+   sScan.pcHigh = pcHigh;
+   sScan.pcPrefix = pcPrefix;
+   sScan.prefixLength = pcPrefix == NULL ? 0 : strlen(pcPrefix);
+   sScan.pfApply = pfApply;
+   sScan.pvExtra = (void*)pvExtra;
+
+   if (oSymTable->psRoot == NULL)
+      return;
+
+   /* The keys are rebuilt in the table's buffer. A scan that *pfApply
+   starts finds it taken and uses one of its own, and visits nothing if
+   insufficient memory is available for that. */
+   sScan.pcKey = oSymTable->pcKeyBuffer;
+   oSymTable->pcKeyBuffer = NULL;
+   if (sScan.pcKey == NULL) {
+      sScan.pcKey = (char*)malloc(oSymTable->keyBufferSize);
+      if (sScan.pcKey == NULL)
+         return;
+   }
+
+   (void)SymTable_scanNode(oSymTable->psRoot, 0, pcLow != NULL, &sScan);
+
+   free(oSymTable->pcKeyBuffer);
+   oSymTable->pcKeyBuffer = sScan.pcKey;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_map(SymTable_T oSymTable,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+
+   assert(oSymTable != NULL);
+   assert(pfApply != NULL);
+
+   SymTable_scan(oSymTable, NULL, NULL, NULL, pfApply, pvExtra);
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_mapRange(SymTable_T oSymTable, const char *pcLow,
+   const char *pcHigh,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+
+   assert(oSymTable != NULL);
+   assert(pfApply != NULL);
+
+   SymTable_scan(oSymTable, pcLow, pcHigh, NULL, pfApply, pvExtra);
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+
+   assert(oSymTable != NULL);
+   assert(pcPrefix != NULL);
+   assert(pfApply != NULL);
+
+   /* the keys with the prefix start at the prefix itself */
+   SymTable_scan(oSymTable, pcPrefix, NULL, pcPrefix, pfApply,
+      pvExtra);
+}
+
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,897 @@
+/*--------------------------------------------------------------------*/
+/* symtablebtree.c                                                    */
+/* Author: Angel Chang Liu                                            */
+/*--------------------------------------------------------------------*/
+
+#include "symtableordered.h"
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdint.h>
+
+/* The table is a B-tree ordered by strcmp. Every node but the root
+holds MIN_DEGREE - 1 to MAX_KEYS bindings and all leaves are equally
+deep, so the tree stays a few levels deep even for millions of
+bindings. Each node packs the first PREFIX_LENGTH characters of its
+keys into integers, side by side, so a binary search within a node
+mostly compares integers from a few cache lines and only follows a
+key pointer when two prefixes tie. */
+
+/* minimum degree of the B-tree: every node but the root has at least
+MIN_DEGREE - 1 bindings, and an internal node one child more */
+enum {MIN_DEGREE = 16};
+
+/* maximum number of bindings in a node */
+enum {MAX_KEYS = 2 * MIN_DEGREE - 1};
+
+/* number of characters of a key packed into its prefix */
+enum {PREFIX_LENGTH = 8};
+
+/* A node of the B-tree. Its bindings are kept in key order, spread
+over three parallel arrays. */
+struct Node {
+   /* Stores the number of bindings in the node */
+   size_t numKeys;
+   /* Nonzero (TRUE) if the node has no children */
+   int isLeaf;
+   /* The first PREFIX_LENGTH characters of each key, most significant
+   first and padded with '\0', so that prefixes compare as their keys
+   do */
+   uint64_t auPrefix[MAX_KEYS];
+   /* Strings that uniquely identify the bindings, each in memory of
+   its own */
+   char *apcKeys[MAX_KEYS];
+   /* Data that is somehow pertinent to each key */
+   void *apvValues[MAX_KEYS];
+   /* The numKeys + 1 children of an internal node, where child i
+   holds the keys between keys i - 1 and i. Only internal nodes are
+   allocated with room for MAX_KEYS + 1 of them. */
+   struct Node *apsChildren[];
+};
+
+/* A binding taken out of or put into a node */
+struct Entry {
+   /* The packed prefix of key */
+   uint64_t prefix;
+   /* A string that uniquely identifies its binding */
+   char *key;
+   /* Data that is somehow pertinent to its key */
+   void *value;
+};
+
+/* Collection of key value pairs */
+struct SymTable {
+   /* The root of the B-tree, never NULL */
+   struct Node *psRoot;
+   /* Stores the number of bindings */
+   size_t numBindings;
+};
+
+/* The bounds and function of a SymTable_mapRange or
+SymTable_mapPrefix call */
+struct Scan {
+   /* Keys not less than pcHigh end the scan, unless it is NULL */
+   const char *pcHigh;
+   /* Keys that do not start with pcPrefix end the scan, unless it is
+   NULL */
+   const char *pcPrefix;
+   /* Stores the length of pcPrefix */
+   size_t prefixLength;
+   /* The function to apply to each binding and its extra parameter */
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra);
+   void *pvExtra;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the first PREFIX_LENGTH characters of pcKey packed into an
+integer, most significant first and padded with '\0'. */
+
+static uint64_t SymTable_prefix(const char *pcKey) {
+   uint64_t uPrefix = 0;
+   size_t u;
+
+   assert(pcKey != NULL);
+
+   for (u = 0; u < PREFIX_LENGTH; u++) {
+      uPrefix <<= 8;
+      if (*pcKey != '\0') {
+         uPrefix |= (uint64_t)(unsigned char)*pcKey;
+         pcKey++;
+      }
+   }
+   return uPrefix;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Compares pcKey, whose packed prefix is uPrefix, with key i of
+psNode as strcmp would, returning a negative number, 0 or a positive
+number. */
+
+static int SymTable_compare(uint64_t uPrefix, const char *pcKey,
+   const struct Node *psNode, size_t i) {
+
+   assert(pcKey != NULL);
+   assert(psNode != NULL);
+   assert(i < psNode->numKeys);
+
+   if (uPrefix != psNode->auPrefix[i])
+      return uPrefix < psNode->auPrefix[i] ? -1 : 1;
+
+   /* equal prefixes that hold a '\0' are equal keys; otherwise the
+   keys differ, if at all, after the prefix */
+   if ((uPrefix & 0xFF) == 0)
+      return 0;
+   return strcmp(pcKey + PREFIX_LENGTH,
+      psNode->apcKeys[i] + PREFIX_LENGTH);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the index of the first key of psNode that is not less than
+pcKey, whose packed prefix is uPrefix, or psNode->numKeys if there is
+none. Sets *piFound to 1 (TRUE) if that key is pcKey and to 0 (FALSE)
+otherwise. */
+
+static size_t SymTable_search(const struct Node *psNode,
+   uint64_t uPrefix, const char *pcKey, int *piFound) {
+
+   size_t uLow = 0;
+   size_t uHigh;
+   size_t uMid;
+   int iCmp;
+
+   assert(psNode != NULL);
+   assert(pcKey != NULL);
+   assert(piFound != NULL);
+
+   *piFound = 0;
+   uHigh = psNode->numKeys;
+   while (uLow < uHigh) {
+      uMid = uLow + (uHigh - uLow) / 2;
+      iCmp = SymTable_compare(uPrefix, pcKey, psNode, uMid);
+      if (iCmp == 0) {
+         *piFound = 1;
+         return uMid;
+      }
+      if (iCmp > 0)
+         uLow = uMid + 1;
+      else
+         uHigh = uMid;
+   }
+   return uLow;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a new node with no bindings, a leaf if isLeaf is nonzero
+(TRUE), or NULL if insufficient memory is available. */
+
+static struct Node *SymTable_newNode(int isLeaf) {
+   struct Node *psNode;
+
+   /* leaves have no children to point to */
+   if (isLeaf)
+      psNode = (struct Node*)malloc(sizeof(struct Node));
+   else
+      psNode = (struct Node*)malloc(sizeof(struct Node) +
+         (MAX_KEYS + 1) * sizeof(struct Node*));
+   if (psNode == NULL)
+      return NULL;
+
+   psNode->numKeys = 0;
+   psNode->isLeaf = isLeaf;
+   return psNode;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Copies count bindings of psSrc, from index src on, to psDst from
+index dst on. The ranges may overlap. */
+
+static void SymTable_moveEntries(struct Node *psDst, size_t dst,
+   const struct Node *psSrc, size_t src, size_t count) {
+
+   assert(psDst != NULL);
+   assert(psSrc != NULL);
+
+   memmove(&psDst->auPrefix[dst], &psSrc->auPrefix[src],
+      count * sizeof(psSrc->auPrefix[0]));
+   memmove(&psDst->apcKeys[dst], &psSrc->apcKeys[src],
+      count * sizeof(psSrc->apcKeys[0]));
+   memmove(&psDst->apvValues[dst], &psSrc->apvValues[src],
+      count * sizeof(psSrc->apvValues[0]));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Copies count children of psSrc, from index src on, to psDst from
+index dst on. The ranges may overlap. */
+
+static void SymTable_moveChildren(struct Node *psDst, size_t dst,
+   const struct Node *psSrc, size_t src, size_t count) {
+
+   assert(psDst != NULL);
+   assert(psSrc != NULL);
+
+   memmove(&psDst->apsChildren[dst], &psSrc->apsChildren[src],
+      count * sizeof(psSrc->apsChildren[0]));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Copies binding i of psNode into *psEntry. */
+
+static void SymTable_getEntry(const struct Node *psNode, size_t i,
+   struct Entry *psEntry) {
+
+   assert(psNode != NULL);
+   assert(psEntry != NULL);
+
+   psEntry->prefix = psNode->auPrefix[i];
+   psEntry->key = psNode->apcKeys[i];
+   psEntry->value = psNode->apvValues[i];
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Makes *psEntry binding i of psNode. */
+
+static void SymTable_setEntry(struct Node *psNode, size_t i,
+   const struct Entry *psEntry) {
+
+   assert(psNode != NULL);
+   assert(psEntry != NULL);
+
+   psNode->auPrefix[i] = psEntry->prefix;
+   psNode->apcKeys[i] = psEntry->key;
+   psNode->apvValues[i] = psEntry->value;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Splits child i of psParent, which must be full, into two halves,
+moving its middle binding up to index i of psParent, which must not
+be full. Returns 1 (TRUE) on success, or 0 (FALSE) and leaves the
+tree unchanged if insufficient memory is available. */
+
+static int SymTable_splitChild(struct Node *psParent, size_t i) {
+   struct Node *psLeft;
+   struct Node *psRight;
+
+   assert(psParent != NULL);
+   assert(psParent->numKeys < MAX_KEYS);
+
+   psLeft = psParent->apsChildren[i];
+   assert(psLeft->numKeys == MAX_KEYS);
+
+   psRight = SymTable_newNode(psLeft->isLeaf);
+   if (psRight == NULL)
+      return 0;
+
+   /* the upper half of psLeft goes to psRight */
+   SymTable_moveEntries(psRight, 0, psLeft, MIN_DEGREE, MIN_DEGREE - 1);
+   if (! psLeft->isLeaf)
+      SymTable_moveChildren(psRight, 0, psLeft, MIN_DEGREE, MIN_DEGREE);
+   psRight->numKeys = MIN_DEGREE - 1;
+   psLeft->numKeys = MIN_DEGREE - 1;
+
+   /* the middle binding goes up between the halves */
+   SymTable_moveEntries(psParent, i + 1, psParent, i,
+      psParent->numKeys - i);
+   SymTable_moveChildren(psParent, i + 2, psParent, i + 1,
+      psParent->numKeys - i);
+   SymTable_moveEntries(psParent, i, psLeft, MIN_DEGREE - 1, 1);
+   psParent->apsChildren[i + 1] = psRight;
+   psParent->numKeys++;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Merges child i + 1 of psParent into child i, with binding i of
+psParent between them. The two children must hold MAX_KEYS - 1
+bindings in all. */
+
+static void SymTable_merge(struct Node *psParent, size_t i) {
+   struct Node *psLeft;
+   struct Node *psRight;
+
+   assert(psParent != NULL);
+   assert(i < psParent->numKeys);
+
+   psLeft = psParent->apsChildren[i];
+   psRight = psParent->apsChildren[i + 1];
+   assert(psLeft->numKeys + psRight->numKeys + 1 <= MAX_KEYS);
+
+   SymTable_moveEntries(psLeft, psLeft->numKeys, psParent, i, 1);
+   SymTable_moveEntries(psLeft, psLeft->numKeys + 1, psRight, 0,
+      psRight->numKeys);
+   if (! psLeft->isLeaf)
+      SymTable_moveChildren(psLeft, psLeft->numKeys + 1, psRight, 0,
+         psRight->numKeys + 1);
+   psLeft->numKeys += psRight->numKeys + 1;
+   free(psRight);
+
+   SymTable_moveEntries(psParent, i, psParent, i + 1,
+      psParent->numKeys - i - 1);
+   SymTable_moveChildren(psParent, i + 1, psParent, i + 2,
+      psParent->numKeys - i - 1);
+   psParent->numKeys--;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Makes sure that child i of psParent has at least MIN_DEGREE
+bindings, so that one can be removed from it, by moving one over from
+a sibling or by merging it with a sibling. Returns the index that the
+child then has, which changes if it was merged into its left
+sibling. */
+
+static size_t SymTable_fill(struct Node *psParent, size_t i) {
+   struct Node *psChild;
+   struct Node *psSibling;
+
+   assert(psParent != NULL);
+   assert(! psParent->isLeaf);
+   assert(i <= psParent->numKeys);
+
+   psChild = psParent->apsChildren[i];
+   if (psChild->numKeys >= MIN_DEGREE)
+      return i;
+
+   /* rotate a binding over from the left sibling */
+   if (i > 0 && psParent->apsChildren[i - 1]->numKeys >= MIN_DEGREE) {
+      psSibling = psParent->apsChildren[i - 1];
+      SymTable_moveEntries(psChild, 1, psChild, 0, psChild->numKeys);
+      SymTable_moveEntries(psChild, 0, psParent, i - 1, 1);
+      if (! psChild->isLeaf) {
+         SymTable_moveChildren(psChild, 1, psChild, 0,
+            psChild->numKeys + 1);
+         psChild->apsChildren[0] =
+            psSibling->apsChildren[psSibling->numKeys];
+      }
+      SymTable_moveEntries(psParent, i - 1, psSibling,
+         psSibling->numKeys - 1, 1);
+      psSibling->numKeys--;
+      psChild->numKeys++;
+      return i;
+   }
+
+   /* rotate a binding over from the right sibling */
+   if (i < psParent->numKeys &&
+      psParent->apsChildren[i + 1]->numKeys >= MIN_DEGREE) {
+      psSibling = psParent->apsChildren[i + 1];
+      SymTable_moveEntries(psChild, psChild->numKeys, psParent, i, 1);
+      SymTable_moveEntries(psParent, i, psSibling, 0, 1);
+      SymTable_moveEntries(psSibling, 0, psSibling, 1,
+         psSibling->numKeys - 1);
+      if (! psChild->isLeaf) {
+         psChild->apsChildren[psChild->numKeys + 1] =
+            psSibling->apsChildren[0];
+         SymTable_moveChildren(psSibling, 0, psSibling, 1,
+            psSibling->numKeys);
+      }
+      psSibling->numKeys--;
+      psChild->numKeys++;
+      return i;
+   }
+
+   /* both siblings are minimal, so merge with one of them */
+   if (i < psParent->numKeys) {
+      SymTable_merge(psParent, i);
+      return i;
+   }
+   SymTable_merge(psParent, i - 1);
+   return i - 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Removes the greatest binding of the subtree whose root is psNode,
+which must have at least MIN_DEGREE bindings, and stores it in
+*psEntry. */
+
+static void SymTable_removeMax(struct Node *psNode,
+   struct Entry *psEntry) {
+
+   assert(psNode != NULL);
+   assert(psEntry != NULL);
+
+   while (! psNode->isLeaf)
+      psNode = psNode->apsChildren[SymTable_fill(psNode,
+         psNode->numKeys)];
+
+   SymTable_getEntry(psNode, psNode->numKeys - 1, psEntry);
+   psNode->numKeys--;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Removes the least binding of the subtree whose root is psNode,
+which must have at least MIN_DEGREE bindings, and stores it in
+*psEntry. */
+
+static void SymTable_removeMin(struct Node *psNode,
+   struct Entry *psEntry) {
+
+   assert(psNode != NULL);
+   assert(psEntry != NULL);
+
+   while (! psNode->isLeaf)
+      psNode = psNode->apsChildren[SymTable_fill(psNode, 0)];
+
+   SymTable_getEntry(psNode, 0, psEntry);
+   SymTable_moveEntries(psNode, 0, psNode, 1, psNode->numKeys - 1);
+   psNode->numKeys--;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Frees the subtree whose root is psNode, with all of its keys. */
+
+static void SymTable_freeNode(struct Node *psNode) {
+   size_t i;
+
+   assert(psNode != NULL);
+
+   for (i = 0; i < psNode->numKeys; i++)
+      free(psNode->apcKeys[i]);
+   if (! psNode->isLeaf)
+      for (i = 0; i <= psNode->numKeys; i++)
+         SymTable_freeNode(psNode->apsChildren[i]);
+   free(psNode);
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_new(void) {
+   SymTable_T oSymTable;
+
+   /* allocate new memory */
+   oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
+   if (oSymTable == NULL)
+      return NULL;
+
+   oSymTable->psRoot = SymTable_newNode(1);
+   if (oSymTable->psRoot == NULL) {
+      free(oSymTable);
+      return NULL;
+   }
+   oSymTable->numBindings = 0;
+   return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_free(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+
+   SymTable_freeNode(oSymTable->psRoot);
+   free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getLength(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+
+   return oSymTable->numBindings;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the address of the value of the binding of oSymTable whose
+key is pcKey, or NULL if there is no such binding. */
+
+static void **SymTable_lookup(SymTable_T oSymTable, const char *pcKey) {
+   struct Node *psNode;
+   uint64_t uPrefix;
+   size_t i;
+   int iFound;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   uPrefix = SymTable_prefix(pcKey);
+   for (psNode = oSymTable->psRoot; ;
+      psNode = psNode->apsChildren[i]) {
+
+      i = SymTable_search(psNode, uPrefix, pcKey, &iFound);
+      if (iFound)
+         return &psNode->apvValues[i];
+      if (psNode->isLeaf)
+         return NULL;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the address of the value of the binding of oSymTable whose
+key is pcKey, and sets *piInserted to 0 (FALSE). If there is no such
+binding, adds one of pcKey to pvValue, returns the address of its
+value and sets *piInserted to 1 (TRUE). If insufficient memory is
+available, leaves the bindings of oSymTable unchanged and returns
+NULL. Full nodes are split on the way down, so there is always room
+for the new binding in its leaf. */
+
+static void **SymTable_findOrAdd(SymTable_T oSymTable,
+   const char *pcKey, const void *pvValue, int *piInserted) {
+
+   struct Node *psNode;
+   struct Node *psNewRoot;
+   uint64_t uPrefix;
+   size_t keyLength;
+   size_t i;
+   char *pcNewKey;
+   int iFound;
+   int iCmp;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(piInserted != NULL);
+
+   *piInserted = 0;
+   uPrefix = SymTable_prefix(pcKey);
+
+   /* a full root is split under a new root, which is how the tree
+   grows a level */
+   psNode = oSymTable->psRoot;
+   if (psNode->numKeys == MAX_KEYS) {
+      psNewRoot = SymTable_newNode(0);
+      if (psNewRoot == NULL)
+         return NULL;
+      psNewRoot->apsChildren[0] = psNode;
+      if (! SymTable_splitChild(psNewRoot, 0)) {
+         free(psNewRoot);
+         return NULL;
+      }
+      oSymTable->psRoot = psNode = psNewRoot;
+   }
+
+   for (;;) {
+      i = SymTable_search(psNode, uPrefix, pcKey, &iFound);
+      if (iFound)
+         return &psNode->apvValues[i];
+      if (psNode->isLeaf)
+         break;
+
+      if (psNode->apsChildren[i]->numKeys == MAX_KEYS) {
+         if (! SymTable_splitChild(psNode, i))
+            return NULL;
+         /* the binding moved up to index i may be the one wanted, or
+         may send the search to the new right half */
+         iCmp = SymTable_compare(uPrefix, pcKey, psNode, i);
+         if (iCmp == 0)
+            return &psNode->apvValues[i];
+         if (iCmp > 0)
+            i++;
+      }
+      psNode = psNode->apsChildren[i];
+   }
+
+   /* allocate the key and add the binding at index i of the leaf */
+   keyLength = strlen(pcKey);
+   pcNewKey = (char*)malloc(keyLength + 1);
+   if (pcNewKey == NULL)
+      return NULL;
+   memcpy(pcNewKey, pcKey, keyLength + 1);
+
+   SymTable_moveEntries(psNode, i + 1, psNode, i, psNode->numKeys - i);
+   psNode->auPrefix[i] = uPrefix;
+   psNode->apcKeys[i] = pcNewKey;
+   psNode->apvValues[i] = (void*)pvValue;
+   psNode->numKeys++;
+   oSymTable->numBindings++;
+
+   *piInserted = 1;
+   return &psNode->apvValues[i];
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_put(SymTable_T oSymTable,
+   const char *pcKey, const void *pvValue) {
+
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   (void)SymTable_findOrAdd(oSymTable, pcKey, pvValue, &iInserted);
+   return iInserted;
+}
+
+/*--------------------------------------------------------------------*/
+
+void **SymTable_findOrInsert(SymTable_T oSymTable, const char *pcKey,
+   const void *pvValue, int *piInserted) {
+
+   void **ppvValue;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   ppvValue = SymTable_findOrAdd(oSymTable, pcKey, pvValue, &iInserted);
+   if (piInserted != NULL)
+      *piInserted = iInserted;
+   return ppvValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_upsert(SymTable_T oSymTable, const char *pcKey,
+   const void *pvValue) {
+
+   void **ppvValue;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   /* one descent either finds the binding or adds it */
+   ppvValue = SymTable_findOrAdd(oSymTable, pcKey, pvValue, &iInserted);
+   if (ppvValue == NULL)
+      return 0;
+
+   if (! iInserted)
+      *ppvValue = (void*)pvValue;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_replace(SymTable_T oSymTable,
+   const char *pcKey, const void *pvValue) {
+
+   void *temp;
+   void **ppvValue;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   ppvValue = SymTable_lookup(oSymTable, pcKey);
+   if (ppvValue == NULL)
+      return NULL;
+
+   temp = *ppvValue;
+   *ppvValue = (void*)pvValue;
+   return temp;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   return SymTable_lookup(oSymTable, pcKey) != NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+   void **ppvValue;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   ppvValue = SymTable_lookup(oSymTable, pcKey);
+   if (ppvValue == NULL)
+      return NULL;
+
+   return *ppvValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+   struct Node *psNode;
+   struct Node *psChild;
+   struct Entry sRemoved;
+   struct Entry sReplacement;
+   uint64_t uPrefix;
+   size_t i;
+   int iFound;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   uPrefix = SymTable_prefix(pcKey);
+
+   /* Every node entered on the way down is first given a spare
+   binding, so that the removal never leaves a node too small. */
+   psNode = oSymTable->psRoot;
+   for (;;) {
+      i = SymTable_search(psNode, uPrefix, pcKey, &iFound);
+
+      if (psNode->isLeaf) {
+         if (! iFound)
+            break;
+         SymTable_getEntry(psNode, i, &sRemoved);
+         SymTable_moveEntries(psNode, i, psNode, i + 1,
+            psNode->numKeys - i - 1);
+         psNode->numKeys--;
+         break;
+      }
+
+      if (iFound) {
+         /* replace the binding by its predecessor or successor,
+         or merge the children around it and look again */
+         psChild = psNode->apsChildren[i];
+         if (psChild->numKeys >= MIN_DEGREE) {
+            SymTable_getEntry(psNode, i, &sRemoved);
+            SymTable_removeMax(psChild, &sReplacement);
+            SymTable_setEntry(psNode, i, &sReplacement);
+            break;
+         }
+         psChild = psNode->apsChildren[i + 1];
+         if (psChild->numKeys >= MIN_DEGREE) {
+            SymTable_getEntry(psNode, i, &sRemoved);
+            SymTable_removeMin(psChild, &sReplacement);
+            SymTable_setEntry(psNode, i, &sReplacement);
+            break;
+         }
+         SymTable_merge(psNode, i);
+         psNode = psNode->apsChildren[i];
+         continue;
+      }
+
+      psNode = psNode->apsChildren[SymTable_fill(psNode, i)];
+   }
+
+   /* a root emptied by a merge gives way to its only child, even if
+   the key was not found */
+   psChild = oSymTable->psRoot;
+   if (psChild->numKeys == 0 && ! psChild->isLeaf) {
+      oSymTable->psRoot = psChild->apsChildren[0];
+      free(psChild);
+   }
+   if (! iFound)
+      return NULL;
+
+   free(sRemoved.key);
+   oSymTable->numBindings--;
+   return sRemoved.value;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Applies function *pfApply to each binding of the subtree whose
+root is psNode, in key order, passing pvExtra as an extra
+parameter. */
+
+static void SymTable_mapNode(struct Node *psNode,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   void *pvExtra) {
+
+   size_t i;
+
+   assert(psNode != NULL);
+   assert(pfApply != NULL);
+
+   for (i = 0; i <= psNode->numKeys; i++) {
+      if (! psNode->isLeaf)
+         SymTable_mapNode(psNode->apsChildren[i], pfApply, pvExtra);
+      if (i < psNode->numKeys)
+         (*pfApply)(psNode->apcKeys[i], psNode->apvValues[i], pvExtra);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_map(SymTable_T oSymTable,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+
+   assert(oSymTable != NULL);
+   assert(pfApply != NULL);
+
+   SymTable_mapNode(oSymTable->psRoot, pfApply, (void*)pvExtra);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns 1 (TRUE) if pcKey lies past the end of the scan *psScan,
+and 0 (FALSE) otherwise. */
+
+static int SymTable_pastEnd(const struct Scan *psScan,
+   const char *pcKey) {
+
+   assert(psScan != NULL);
+   assert(pcKey != NULL);
+
+   if (psScan->pcHigh != NULL && strcmp(pcKey, psScan->pcHigh) >= 0)
+      return 1;
+   if (psScan->pcPrefix != NULL &&
+      strncmp(pcKey, psScan->pcPrefix, psScan->prefixLength) != 0)
+      return 1;
+   return 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Applies the function of *psScan to the bindings of the subtree
+whose root is psNode, in key order, starting with the first key that
+is not less than pcLow, whose packed prefix is uLowPrefix, or with
+the first key of all if pcLow is NULL. Returns 1 (TRUE) once a key
+past the end of the scan is reached, and 0 (FALSE) otherwise. */
+
+static int SymTable_scanNode(const struct Node *psNode,
+   const char *pcLow, uint64_t uLowPrefix, const struct Scan *psScan) {
+
+   size_t i = 0;
+   int iFound = 0;
+
+   assert(psNode != NULL);
+   assert(psScan != NULL);
+
+   /* only the subtrees left of the start need pcLow; children left of
+   an exact match hold smaller keys and are skipped */
+   if (pcLow != NULL)
+      i = SymTable_search(psNode, uLowPrefix, pcLow, &iFound);
+
+   for (; i <= psNode->numKeys; i++) {
+      if (! psNode->isLeaf && ! iFound)
+         if (SymTable_scanNode(psNode->apsChildren[i], pcLow,
+            uLowPrefix, psScan))
+            return 1;
+      pcLow = NULL;
+      iFound = 0;
+
+      if (i == psNode->numKeys)
+         break;
+      if (SymTable_pastEnd(psScan, psNode->apcKeys[i]))
+         return 1;
+      (*psScan->pfApply)(psNode->apcKeys[i], psNode->apvValues[i],
+         psScan->pvExtra);
+   }
+   return 0;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_mapRange(SymTable_T oSymTable, const char *pcLow,
+   const char *pcHigh,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+
+   struct Scan sScan;
+
+   assert(oSymTable != NULL);
+   assert(pfApply != NULL);
+
+   sScan.pcHigh = pcHigh;
+   sScan.pcPrefix = NULL;
+   sScan.prefixLength = 0;
+   sScan.pfApply = pfApply;
+   sScan.pvExtra = (void*)pvExtra;
+   (void)SymTable_scanNode(oSymTable->psRoot, pcLow,
+      pcLow == NULL ? 0 : SymTable_prefix(pcLow), &sScan);
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+
+   struct Scan sScan;
+
+   assert(oSymTable != NULL);
+   assert(pcPrefix != NULL);
+   assert(pfApply != NULL);
+
+   /* the keys with the prefix start at the prefix itself */
+   sScan.pcHigh = NULL;
+   sScan.pcPrefix = pcPrefix;
+   sScan.prefixLength = strlen(pcPrefix);
+   sScan.pfApply = pfApply;
+   sScan.pvExtra = (void*)pvExtra;
+   (void)SymTable_scanNode(oSymTable->psRoot, pcPrefix,
+      SymTable_prefix(pcPrefix), &sScan);
+}
+
+/*--------------------------------------------------------------------*/
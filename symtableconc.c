@@ -0,0 +1,608 @@
+/*--------------------------------------------------------------------*/
+/* symtableconc.c                                                     */
+/* Author: Angel Chang Liu                                            */
+/*--------------------------------------------------------------------*/
+
+/* rwlocks are a POSIX feature beyond plain C99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include "symtable.h"
+#include "symtablestrhash.h"
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/* A hash table that several threads may use at once. The buckets are
+shared out among NUM_STRIPES stripes, bucket b belonging to stripe
+b % NUM_STRIPES, and each stripe has a reader/writer lock. Lookups
+take their stripe's lock for reading and changes take it for writing,
+so threads working on different stripes never wait for each other, and
+readers of the same stripe only wait for its writers. Growing the table
+takes every stripe's lock for writing. Each stripe counts its own
+bindings, so changes to different stripes never write to the same
+memory.
+
+Every function releases its locks before it returns. Growing relinks
+bindings rather than moving them, so the address that
+SymTable_findOrInsert returns stays valid until a thread removes the
+binding; a caller that shares the table must see to it that no other
+thread removes the binding while it uses the address. */
+
+#ifndef __GNUC__
+#error "symtableconc.c needs the __atomic builtins of GCC or Clang"
+#endif
+
+/* number of stripes, a power of two */
+enum {NUM_STRIPES = 64};
+
+/* number of buckets of a new table, a power of two and a multiple of
+NUM_STRIPES */
+enum {INITIAL_BUCKET_COUNT = 512};
+
+/* Assumed size of a cache line. Stripes are kept at least this far
+apart, so that locking one stripe does not slow down threads that use
+its neighbours. */
+enum {CACHE_LINE_SIZE = 64};
+
+/* Each key/value is stored in a Binding. Bindings are linked to form a
+SymTable. A Binding and its key are a single allocation. */
+struct Binding {
+   /* A node that links the current Node with the next Node */
+   struct Binding *psNextBinding;
+   /* The full hash code of key, before it is reduced to a bucket */
+   uint64_t hash;
+   /* Data that is somehow pertinent to its key */
+   void *value;
+   /* A string that uniquely identifies its binding, stored inline */
+   char key[];
+};
+
+/* The lock and binding count of one stripe, padded to keep other
+stripes off their cache line */
+struct Stripe {
+   /* Held for reading to look at the stripe's buckets and for writing
+   to change them */
+   pthread_rwlock_t lock;
+   /* Stores the number of bindings in the stripe's buckets; changed
+   only while holding lock for writing, and read with atomic loads by
+   SymTable_getLength, which takes no lock */
+   size_t numBindings;
+   char acPad[CACHE_LINE_SIZE];
+};
+
+/* Collection of key value pairs */
+struct SymTable {
+   /* Array of numBucketCounts lists; bucket b may only be used while
+   holding the lock of stripe b % NUM_STRIPES, and buckets and
+   numBucketCounts only change while holding every stripe's lock */
+   struct Binding **buckets;
+   /* Stores the number of buckets, a power of two */
+   size_t numBucketCounts;
+   /* Keeps buckets and numBucketCounts, which every call reads, off
+   the cache line of the first stripe, which its writers change */
+   char acPad[CACHE_LINE_SIZE];
+   /* The stripes */
+   struct Stripe aStripes[NUM_STRIPES];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the stripe of the input oSymTable that holds the bucket of
+a key whose hash code is hash. The bucket count is a multiple of
+NUM_STRIPES, so the stripe does not depend on it and may be found
+before taking any lock. */
+
+static struct Stripe *SymTable_stripeFor(SymTable_T oSymTable,
+   uint64_t hash) {
+
+   assert(oSymTable != NULL);
+
+   return &oSymTable->aStripes[hash & (NUM_STRIPES - 1)];
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Adds delta, 1 or -1 as a size_t, to the binding count of psStripe,
+whose lock the caller holds for writing. */
+
+static void SymTable_count(struct Stripe *psStripe, size_t delta) {
+   assert(psStripe != NULL);
+
+   __atomic_store_n(&psStripe->numBindings,
+      psStripe->numBindings + delta, __ATOMIC_RELAXED);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns 1 (TRUE) if psStripe of the input oSymTable holds more
+bindings than buckets, so that the table is due to grow, and 0 (FALSE)
+otherwise. The caller must hold the stripe's lock. */
+
+static int SymTable_isCrowded(SymTable_T oSymTable,
+   const struct Stripe *psStripe) {
+
+   assert(oSymTable != NULL);
+   assert(psStripe != NULL);
+
+   return psStripe->numBindings >
+      oSymTable->numBucketCounts / NUM_STRIPES;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the address of the bucket of the input oSymTable for a key
+whose hash code is hash. The caller must hold the bucket's stripe
+lock. */
+
+static struct Binding **SymTable_bucketFor(SymTable_T oSymTable,
+   uint64_t hash) {
+
+   assert(oSymTable != NULL);
+
+   return &oSymTable->buckets[hash & (oSymTable->numBucketCounts - 1)];
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the binding in the list whose first binding is psFirstBinding
+whose key is pcKey and whose hash code is hash, or NULL if there is no
+such binding. */
+
+static struct Binding *SymTable_find(struct Binding *psFirstBinding,
+   const char *pcKey, uint64_t hash) {
+
+   struct Binding *psCurrentBinding;
+
+   assert(pcKey != NULL);
+
+   for (psCurrentBinding = psFirstBinding;
+      psCurrentBinding != NULL;
+      psCurrentBinding = psCurrentBinding->psNextBinding) {
+
+      if (psCurrentBinding->hash == hash &&
+         strcmp(psCurrentBinding->key, pcKey) == 0) {
+         return psCurrentBinding;
+      }
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Lock every stripe of the input oSymTable, for writing if iWrite is
+nonzero (TRUE) and for reading otherwise. Stripes are always locked in
+the same order, so two threads doing this cannot deadlock. */
+
+static void SymTable_lockAll(SymTable_T oSymTable, int iWrite) {
+   size_t i;
+
+   assert(oSymTable != NULL);
+
+   for (i = 0; i < NUM_STRIPES; i++) {
+      if (iWrite)
+         pthread_rwlock_wrlock(&oSymTable->aStripes[i].lock);
+      else
+         pthread_rwlock_rdlock(&oSymTable->aStripes[i].lock);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Unlock every stripe of the input oSymTable. */
+
+static void SymTable_unlockAll(SymTable_T oSymTable) {
+   size_t i;
+
+   assert(oSymTable != NULL);
+
+   for (i = NUM_STRIPES; i > 0; i--)
+      pthread_rwlock_unlock(&oSymTable->aStripes[i - 1].lock);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Double the number of buckets of the input oSymTable, unless another
+thread has done so since the caller saw numBucketCounts buckets.
+Leaves the table as it is if insufficient memory is available; it
+still works, with longer lists. The caller must hold no stripe lock. */
+
+static void SymTable_grow(SymTable_T oSymTable,
+   size_t numBucketCounts) {
+   struct Binding **newBuckets;
+   struct Binding *psCurrentBinding;
+   struct Binding *psNextBinding;
+   size_t newBucketCount;
+   size_t i;
+
+   assert(oSymTable != NULL);
+
+   SymTable_lockAll(oSymTable, 1);
+
+   if (oSymTable->numBucketCounts != numBucketCounts) {
+      SymTable_unlockAll(oSymTable);
+      return;
+   }
+
+   newBucketCount = 2 * numBucketCounts;
+   newBuckets = (struct Binding**)calloc(newBucketCount,
+      sizeof(struct Binding*));
+   if (newBuckets == NULL) {
+      SymTable_unlockAll(oSymTable);
+      return;
+   }
+
+   /* the cached hashes spare rehashing the keys */
+   for (i = 0; i < numBucketCounts; i++) {
+      for (psCurrentBinding = oSymTable->buckets[i];
+         psCurrentBinding != NULL;
+         psCurrentBinding = psNextBinding) {
+
+         psNextBinding = psCurrentBinding->psNextBinding;
+         psCurrentBinding->psNextBinding = newBuckets[
+            psCurrentBinding->hash & (newBucketCount - 1)];
+         newBuckets[psCurrentBinding->hash & (newBucketCount - 1)] =
+            psCurrentBinding;
+      }
+   }
+
+   free(oSymTable->buckets);
+   oSymTable->buckets = newBuckets;
+   oSymTable->numBucketCounts = newBucketCount;
+
+   SymTable_unlockAll(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_new(void) {
+   SymTable_T oSymTable;
+   size_t i;
+
+   /* allocate new memory */
+   oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
+   if (oSymTable == NULL)
+      return NULL;
+
+   oSymTable->numBucketCounts = INITIAL_BUCKET_COUNT;
+   oSymTable->buckets = (struct Binding**)calloc(INITIAL_BUCKET_COUNT,
+      sizeof(struct Binding*));
+   if (oSymTable->buckets == NULL) {
+      free(oSymTable);
+      return NULL;
+   }
+
+   for (i = 0; i < NUM_STRIPES; i++) {
+      oSymTable->aStripes[i].numBindings = 0;
+      if (pthread_rwlock_init(&oSymTable->aStripes[i].lock, NULL)
+         != 0) {
+         while (i > 0)
+            pthread_rwlock_destroy(&oSymTable->aStripes[--i].lock);
+         free(oSymTable->buckets);
+         free(oSymTable);
+         return NULL;
+      }
+   }
+
+   return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_free(SymTable_T oSymTable) {
+   struct Binding *psCurrentBinding;
+   struct Binding *psNextBinding;
+   size_t i;
+
+   assert(oSymTable != NULL);
+
+   /* no other thread may be using the table any more */
+   for (i = 0; i < oSymTable->numBucketCounts; i++) {
+      for (psCurrentBinding = oSymTable->buckets[i];
+         psCurrentBinding != NULL;
+         psCurrentBinding = psNextBinding) {
+
+         psNextBinding = psCurrentBinding->psNextBinding;
+         free(psCurrentBinding);
+      }
+   }
+
+   for (i = 0; i < NUM_STRIPES; i++)
+      pthread_rwlock_destroy(&oSymTable->aStripes[i].lock);
+   free(oSymTable->buckets);
+   free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getLength(SymTable_T oSymTable) {
+   size_t numBindings = 0;
+   size_t i;
+
+   assert(oSymTable != NULL);
+
+   /* each count is consistent with its stripe, though the sum may
+   miss changes made while it is taken */
+   for (i = 0; i < NUM_STRIPES; i++)
+      numBindings += __atomic_load_n(
+         &oSymTable->aStripes[i].numBindings, __ATOMIC_RELAXED);
+   return numBindings;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the binding of the input oSymTable whose key is pcKey and
+whose hash code is hash, and sets *piInserted to 0 (FALSE); if iReplace
+is nonzero (TRUE), its value is first replaced with pvValue. If there
+is no such binding, adds one of pcKey to pvValue, returns it and sets
+*piInserted to 1 (TRUE). If insufficient memory is available, leaves
+oSymTable unchanged and returns NULL. The caller must hold the lock of
+psStripe, the key's stripe, for writing, so no other thread can come
+between the lookup and the change. */
+
+static struct Binding *SymTable_findOrAddLocked(SymTable_T oSymTable,
+   struct Stripe *psStripe, const char *pcKey, uint64_t hash,
+   const void *pvValue, int iReplace, int *piInserted) {
+
+   struct Binding *psBinding;
+   struct Binding **ppsBucket;
+   size_t keyLength;
+
+   assert(oSymTable != NULL);
+   assert(psStripe != NULL);
+   assert(pcKey != NULL);
+   assert(piInserted != NULL);
+
+   *piInserted = 0;
+
+   ppsBucket = SymTable_bucketFor(oSymTable, hash);
+   psBinding = SymTable_find(*ppsBucket, pcKey, hash);
+   if (psBinding != NULL) {
+      if (iReplace)
+         psBinding->value = (void*)pvValue;
+      return psBinding;
+   }
+
+   /* allocating new memory, with room for the key, and rebinding */
+   keyLength = strlen(pcKey);
+   psBinding = (struct Binding*)malloc(sizeof(struct Binding) +
+      keyLength + 1);
+   if (psBinding == NULL)
+      return NULL;
+   memcpy(psBinding->key, pcKey, keyLength + 1);
+   psBinding->hash = hash;
+   psBinding->value = (void*)pvValue;
+   psBinding->psNextBinding = *ppsBucket;
+   *ppsBucket = psBinding;
+   SymTable_count(psStripe, 1);
+
+   *piInserted = 1;
+   return psBinding;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The same as SymTable_findOrAddLocked, except that it takes and
+releases the key's stripe lock itself, and then grows the table if the
+stripe has become crowded. */
+
+static struct Binding *SymTable_findOrAdd(SymTable_T oSymTable,
+   const char *pcKey, const void *pvValue, int iReplace,
+   int *piInserted) {
+
+   struct Binding *psBinding;
+   struct Stripe *psStripe;
+   size_t numBucketCounts;
+   uint64_t hash;
+   int iCrowded;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(piInserted != NULL);
+
+   hash = SymTable_strhash(pcKey);
+   psStripe = SymTable_stripeFor(oSymTable, hash);
+   pthread_rwlock_wrlock(&psStripe->lock);
+   psBinding = SymTable_findOrAddLocked(oSymTable, psStripe, pcKey,
+      hash, pvValue, iReplace, piInserted);
+   numBucketCounts = oSymTable->numBucketCounts;
+   iCrowded = *piInserted && SymTable_isCrowded(oSymTable, psStripe);
+   pthread_rwlock_unlock(&psStripe->lock);
+
+   /* bindings are relinked, not moved, so psBinding stays where it
+   is */
+   if (iCrowded)
+      SymTable_grow(oSymTable, numBucketCounts);
+
+   return psBinding;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_put(SymTable_T oSymTable,
+   const char *pcKey, const void *pvValue) {
+
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   (void)SymTable_findOrAdd(oSymTable, pcKey, pvValue, 0, &iInserted);
+   return iInserted;
+}
+
+/*--------------------------------------------------------------------*/
+
+void **SymTable_findOrInsert(SymTable_T oSymTable, const char *pcKey,
+   const void *pvValue, int *piInserted) {
+
+   struct Binding *psBinding;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   psBinding = SymTable_findOrAdd(oSymTable, pcKey, pvValue, 0,
+      &iInserted);
+   if (piInserted != NULL)
+      *piInserted = iInserted;
+   if (psBinding == NULL)
+      return NULL;
+
+   return &psBinding->value;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_upsert(SymTable_T oSymTable, const char *pcKey,
+   const void *pvValue) {
+
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   return SymTable_findOrAdd(oSymTable, pcKey, pvValue, 1, &iInserted)
+      != NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_replace(SymTable_T oSymTable,
+   const char *pcKey, const void *pvValue) {
+
+   void* temp;
+   struct Binding *psCurrentBinding;
+   struct Stripe *psStripe;
+   uint64_t hash;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   hash = SymTable_strhash(pcKey);
+   psStripe = SymTable_stripeFor(oSymTable, hash);
+   pthread_rwlock_wrlock(&psStripe->lock);
+
+   /* find, and if found, replace */
+   psCurrentBinding = SymTable_find(*SymTable_bucketFor(oSymTable,
+      hash), pcKey, hash);
+   if (psCurrentBinding == NULL) {
+      pthread_rwlock_unlock(&psStripe->lock);
+      return NULL;
+   }
+
+   temp = psCurrentBinding->value;
+   psCurrentBinding->value = (void*)pvValue;
+   pthread_rwlock_unlock(&psStripe->lock);
+   return temp;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+   struct Stripe *psStripe;
+   uint64_t hash;
+   int iFound;
+
+   assert (oSymTable != NULL);
+   assert (pcKey != NULL);
+
+   hash = SymTable_strhash(pcKey);
+   psStripe = SymTable_stripeFor(oSymTable, hash);
+   pthread_rwlock_rdlock(&psStripe->lock);
+   iFound = SymTable_find(*SymTable_bucketFor(oSymTable, hash), pcKey,
+      hash) != NULL;
+   pthread_rwlock_unlock(&psStripe->lock);
+   return iFound;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+   struct Binding *psCurrentBinding;
+   struct Stripe *psStripe;
+   uint64_t hash;
+   void *value = NULL;
+
+   assert (oSymTable != NULL);
+   assert (pcKey != NULL);
+
+   hash = SymTable_strhash(pcKey);
+   psStripe = SymTable_stripeFor(oSymTable, hash);
+   pthread_rwlock_rdlock(&psStripe->lock);
+   psCurrentBinding = SymTable_find(*SymTable_bucketFor(oSymTable,
+      hash), pcKey, hash);
+   if (psCurrentBinding != NULL)
+      value = psCurrentBinding->value;
+   pthread_rwlock_unlock(&psStripe->lock);
+   return value;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+   struct Binding *psCurrentBinding;
+   struct Binding **ppsLink;
+   struct Stripe *psStripe;
+   uint64_t hash;
+   void *temp;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   hash = SymTable_strhash(pcKey);
+   psStripe = SymTable_stripeFor(oSymTable, hash);
+   pthread_rwlock_wrlock(&psStripe->lock);
+
+   /* ppsLink is the pointer that leads to psCurrentBinding */
+   for (ppsLink = SymTable_bucketFor(oSymTable, hash);
+      *ppsLink != NULL;
+      ppsLink = &(*ppsLink)->psNextBinding) {
+
+      psCurrentBinding = *ppsLink;
+      if (psCurrentBinding->hash == hash &&
+         strcmp(psCurrentBinding->key, pcKey) == 0) {
+         *ppsLink = psCurrentBinding->psNextBinding;
+         SymTable_count(psStripe, (size_t)-1);
+         pthread_rwlock_unlock(&psStripe->lock);
+
+         temp = psCurrentBinding->value;
+         free(psCurrentBinding);
+         return temp;
+      }
+   }
+
+   pthread_rwlock_unlock(&psStripe->lock);
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_map(SymTable_T oSymTable,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+
+   struct Binding *psCurrentBinding;
+   size_t i;
+
+   assert(oSymTable != NULL);
+   assert(pfApply != NULL);
+
+   /* other readers may carry on; writers wait until the map is done,
+   so *pfApply must not change oSymTable */
+   SymTable_lockAll(oSymTable, 0);
+   for (i = 0; i < oSymTable->numBucketCounts; i++) {
+      for (psCurrentBinding = oSymTable->buckets[i];
+         psCurrentBinding != NULL;
+         psCurrentBinding = psCurrentBinding->psNextBinding) {
+
+         /* apply the function on each binding */
+         (*pfApply)(psCurrentBinding->key, psCurrentBinding->value,
+            (void*)pvExtra);
+      }
+   }
+   SymTable_unlockAll(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
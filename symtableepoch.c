@@ -0,0 +1,772 @@
+/*--------------------------------------------------------------------*/
+/* symtableepoch.c                                                    */
+/* Author: Angel Chang Liu                                            */
+/*--------------------------------------------------------------------*/
+
+/* pthread_once and friends are POSIX features beyond plain C99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include "symtable.h"
+#include "symtablestrhash.h"
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/* A hash table for tables that are read far more often than they are
+changed, which several threads may use at once. SymTable_get and
+SymTable_contains take no lock and make no atomic read-modify-write:
+they follow pointers that writers publish with release stores. Writers
+take a mutex of the table, so they run one at a time.
+
+A binding that a writer unlinks may still be in use by a reader that
+found it a moment earlier, so it is not freed at once but retired, and
+freed by epoch-based reclamation. Each reading thread has a Reader
+record in which it announces the global epoch while it reads. A
+binding retired in epoch e is freed once no reader announces an epoch
+of e or less, since every later reader starts after the unlink and
+cannot reach it. Growing the table copies the bindings into a new
+bucket array, which is published in one store; the old array and its
+bindings are retired the same way. */
+
+#ifndef __GNUC__
+#error "symtableepoch.c needs the __atomic builtins of GCC or Clang"
+#endif
+
+/* number of buckets of a new table, a power of two */
+enum {INITIAL_BUCKET_COUNT = 512};
+
+/* Number of retired blocks that a table collects before it first
+tries to free them */
+enum {RECLAIM_THRESHOLD = 64};
+
+/* Assumed size of a cache line. Each reader's record gets a line of
+its own, so readers do not slow each other down. */
+enum {CACHE_LINE_SIZE = 64};
+
+/* Each key/value is stored in a Binding. Bindings are linked to form a
+SymTable. A Binding and its key are a single allocation. */
+struct Binding {
+   /* A node that links the current Node with the next Node; readers
+   load it with acquire semantics */
+   struct Binding *psNextBinding;
+   /* The full hash code of key, before it is reduced to a bucket */
+   uint64_t hash;
+   /* Data that is somehow pertinent to its key; readers load it with
+   acquire semantics */
+   void *value;
+   /* Once retired, the next retired Binding of the table, and the
+   epoch in which it was retired. Readers may still follow
+   psNextBinding, so retiring must not change it. */
+   struct Binding *psNextRetired;
+   unsigned long retireEpoch;
+   /* A string that uniquely identifies its binding, stored inline */
+   char key[];
+};
+
+/* A bucket array and its size, published together in one pointer */
+struct BucketArray {
+   /* Stores the number of buckets, a power of two */
+   size_t numBucketCounts;
+   /* Once retired, the next retired BucketArray of the table, and the
+   epoch in which it was retired */
+   struct BucketArray *psNextRetired;
+   unsigned long retireEpoch;
+   /* The first binding of each bucket; readers load them with acquire
+   semantics */
+   struct Binding *buckets[];
+};
+
+/* The record in which one thread announces that it is reading */
+struct Reader {
+   /* The global epoch when the thread started its current read, or 0
+   if it is not reading */
+   unsigned long epoch;
+   /* Nonzero (TRUE) while a thread owns the record */
+   int inUse;
+   /* The next record of the list of all records */
+   struct Reader *psNextReader;
+   char acPad[CACHE_LINE_SIZE];
+};
+
+/* Collection of key value pairs */
+struct SymTable {
+   /* The current bucket array; replaced with release stores */
+   struct BucketArray *psArray;
+   /* Stores the number of bindings */
+   size_t numBindings;
+   /* Held by every call that changes the table */
+   pthread_mutex_t mutex;
+   /* Retired bindings and bucket arrays not yet freed, newest first */
+   struct Binding *psRetiredBindings;
+   struct BucketArray *psRetiredArrays;
+   /* Number of blocks in the two lists above */
+   size_t numRetired;
+   /* Value of numRetired at which to try to free them again; it grows
+   with the blocks that a slow reader holds up, so that each try frees
+   enough to pay for itself */
+   size_t reclaimAt;
+};
+
+/* The global epoch, shared by all tables; never 0 */
+static unsigned long ulGlobalEpoch = 1;
+
+/* The records of all threads that have ever read a table. Records are
+never freed, only reused, so the list may be walked without a lock. */
+static struct Reader *psReaders = NULL;
+
+/* Protects the adding of records to psReaders */
+static pthread_mutex_t sReadersMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* The calling thread's record, or NULL if it has none yet */
+static __thread struct Reader *psThisReader = NULL;
+
+/* Key whose destructor releases a thread's record when it exits */
+static pthread_key_t sReaderKey;
+static pthread_once_t sReaderKeyOnce = PTHREAD_ONCE_INIT;
+
+/*--------------------------------------------------------------------*/
+
+/* Release the Reader record pvReader of a thread that is exiting, so
+that another thread may reuse it. */
+
+static void SymTable_releaseReader(void *pvReader) {
+   assert(pvReader != NULL);
+
+   __atomic_store_n(&((struct Reader*)pvReader)->inUse, 0,
+      __ATOMIC_RELEASE);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Create sReaderKey. Called once. */
+
+static void SymTable_createReaderKey(void) {
+   (void)pthread_key_create(&sReaderKey, SymTable_releaseReader);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the calling thread's Reader record, giving it one first if
+it has none, or NULL if insufficient memory is available. */
+
+static struct Reader *SymTable_getReader(void) {
+   struct Reader *psReader;
+
+   if (psThisReader != NULL)
+      return psThisReader;
+
+   (void)pthread_once(&sReaderKeyOnce, SymTable_createReaderKey);
+
+   pthread_mutex_lock(&sReadersMutex);
+
+   /* reuse the record of a thread that has exited, if there is one */
+   for (psReader = psReaders; psReader != NULL;
+      psReader = psReader->psNextReader)
+      if (! __atomic_load_n(&psReader->inUse, __ATOMIC_ACQUIRE))
+         break;
+
+   if (psReader == NULL) {
+      psReader = (struct Reader*)malloc(sizeof(struct Reader));
+      if (psReader == NULL) {
+         pthread_mutex_unlock(&sReadersMutex);
+         return NULL;
+      }
+      psReader->epoch = 0;
+      psReader->psNextReader = psReaders;
+      __atomic_store_n(&psReaders, psReader, __ATOMIC_RELEASE);
+   }
+   psReader->inUse = 1;
+
+   pthread_mutex_unlock(&sReadersMutex);
+
+   (void)pthread_setspecific(sReaderKey, psReader);
+   psThisReader = psReader;
+   return psReader;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Announce in the input psReader that its thread is about to read. The
+fence orders the announcement before every load of the read, so a
+writer that retires a binding either sees the announcement or has its
+unlink seen by the reader. */
+
+static void SymTable_beginRead(struct Reader *psReader) {
+   assert(psReader != NULL);
+
+   __atomic_store_n(&psReader->epoch,
+      __atomic_load_n(&ulGlobalEpoch, __ATOMIC_RELAXED),
+      __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Announce in the input psReader that its thread has finished
+reading. */
+
+static void SymTable_endRead(struct Reader *psReader) {
+   assert(psReader != NULL);
+
+   __atomic_store_n(&psReader->epoch, 0, __ATOMIC_RELEASE);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free the retired blocks of the input oSymTable that no reader can
+still be using. If iAll is nonzero (TRUE), free all of them; only
+SymTable_free, when no thread may be reading, does that. The caller
+must hold oSymTable's mutex. */
+
+static void SymTable_reclaim(SymTable_T oSymTable, int iAll) {
+   struct Binding *psBinding;
+   struct Binding **ppsBinding;
+   struct BucketArray *psArray;
+   struct BucketArray **ppsArray;
+   struct Reader *psReader;
+   unsigned long minEpoch;
+   unsigned long epoch;
+
+   assert(oSymTable != NULL);
+
+   /* start a new epoch, so readers that start from now on do not hold
+   up anything retired so far */
+   minEpoch = __atomic_add_fetch(&ulGlobalEpoch, 1, __ATOMIC_SEQ_CST);
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+   if (! iAll) {
+      for (psReader = __atomic_load_n(&psReaders, __ATOMIC_ACQUIRE);
+         psReader != NULL;
+         psReader = psReader->psNextReader) {
+
+         epoch = __atomic_load_n(&psReader->epoch, __ATOMIC_ACQUIRE);
+         if (epoch != 0 && epoch < minEpoch)
+            minEpoch = epoch;
+      }
+   }
+
+   /* a block retired in an epoch before every reader's is free; the
+   lists are newest first, so once one block is free so is the rest of
+   its list */
+   ppsBinding = &oSymTable->psRetiredBindings;
+   while (*ppsBinding != NULL && ! iAll &&
+      (*ppsBinding)->retireEpoch >= minEpoch)
+      ppsBinding = &(*ppsBinding)->psNextRetired;
+   while ((psBinding = *ppsBinding) != NULL) {
+      *ppsBinding = psBinding->psNextRetired;
+      free(psBinding);
+      oSymTable->numRetired--;
+   }
+
+   ppsArray = &oSymTable->psRetiredArrays;
+   while (*ppsArray != NULL && ! iAll &&
+      (*ppsArray)->retireEpoch >= minEpoch)
+      ppsArray = &(*ppsArray)->psNextRetired;
+   while ((psArray = *ppsArray) != NULL) {
+      *ppsArray = psArray->psNextRetired;
+      free(psArray);
+      oSymTable->numRetired--;
+   }
+
+   oSymTable->reclaimAt = 2 * oSymTable->numRetired + RECLAIM_THRESHOLD;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Retire the input psBinding, which has been unlinked from the input
+oSymTable, to be freed once no reader can be using it. The caller must
+hold oSymTable's mutex. */
+
+static void SymTable_retireBinding(SymTable_T oSymTable,
+   struct Binding *psBinding) {
+
+   assert(oSymTable != NULL);
+   assert(psBinding != NULL);
+
+   psBinding->retireEpoch = __atomic_load_n(&ulGlobalEpoch,
+      __ATOMIC_SEQ_CST);
+   psBinding->psNextRetired = oSymTable->psRetiredBindings;
+   oSymTable->psRetiredBindings = psBinding;
+   if (++oSymTable->numRetired >= oSymTable->reclaimAt)
+      SymTable_reclaim(oSymTable, 0);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a new bucket array of numBucketCounts empty buckets, or NULL
+if insufficient memory is available. */
+
+static struct BucketArray *SymTable_newArray(size_t numBucketCounts) {
+   struct BucketArray *psArray;
+
+   psArray = (struct BucketArray*)calloc(1, sizeof(struct BucketArray)
+      + numBucketCounts * sizeof(struct Binding*));
+   if (psArray == NULL)
+      return NULL;
+   psArray->numBucketCounts = numBucketCounts;
+   return psArray;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a new binding of pcKey, whose length is keyLength and whose
+hash code is hash, to pvValue, or NULL if insufficient memory is
+available. */
+
+static struct Binding *SymTable_newBinding(const char *pcKey,
+   size_t keyLength, uint64_t hash, const void *pvValue) {
+
+   struct Binding *psBinding;
+
+   assert(pcKey != NULL);
+
+   psBinding = (struct Binding*)malloc(sizeof(struct Binding) +
+      keyLength + 1);
+   if (psBinding == NULL)
+      return NULL;
+   memcpy(psBinding->key, pcKey, keyLength + 1);
+   psBinding->hash = hash;
+   psBinding->value = (void*)pvValue;
+   psBinding->psNextBinding = NULL;
+   return psBinding;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the binding of the input psArray whose key is pcKey and
+whose hash code is hash, or NULL if there is no such binding. Safe to
+call without the mutex, during a read. */
+
+static struct Binding *SymTable_find(struct BucketArray *psArray,
+   const char *pcKey, uint64_t hash) {
+
+   struct Binding *psCurrentBinding;
+
+   assert(psArray != NULL);
+   assert(pcKey != NULL);
+
+   for (psCurrentBinding = __atomic_load_n(&psArray->buckets[
+      hash & (psArray->numBucketCounts - 1)], __ATOMIC_ACQUIRE);
+      psCurrentBinding != NULL;
+      psCurrentBinding = __atomic_load_n(
+         &psCurrentBinding->psNextBinding, __ATOMIC_ACQUIRE)) {
+
+      if (psCurrentBinding->hash == hash &&
+         strcmp(psCurrentBinding->key, pcKey) == 0) {
+         return psCurrentBinding;
+      }
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Replace the bucket array of the input oSymTable with one of twice as
+many buckets holding copies of its bindings. Bindings are copied
+rather than relinked, since readers may still be walking the old
+lists. Leaves the table as it is if insufficient memory is available;
+it still works, with longer lists. The caller must hold oSymTable's
+mutex. */
+
+static void SymTable_grow(SymTable_T oSymTable) {
+   struct BucketArray *psOldArray;
+   struct BucketArray *psNewArray;
+   struct Binding *psCurrentBinding;
+   struct Binding *psCopy;
+   struct Binding **ppsBucket;
+   size_t i;
+
+   assert(oSymTable != NULL);
+
+   psOldArray = oSymTable->psArray;
+   psNewArray = SymTable_newArray(2 * psOldArray->numBucketCounts);
+   if (psNewArray == NULL)
+      return;
+
+   for (i = 0; i < psOldArray->numBucketCounts; i++) {
+      for (psCurrentBinding = psOldArray->buckets[i];
+         psCurrentBinding != NULL;
+         psCurrentBinding = psCurrentBinding->psNextBinding) {
+
+         psCopy = SymTable_newBinding(psCurrentBinding->key,
+            strlen(psCurrentBinding->key), psCurrentBinding->hash,
+            psCurrentBinding->value);
+         if (psCopy == NULL) {
+            /* give up, freeing the copies made so far */
+            for (i = 0; i < psNewArray->numBucketCounts; i++) {
+               while ((psCopy = psNewArray->buckets[i]) != NULL) {
+                  psNewArray->buckets[i] = psCopy->psNextBinding;
+                  free(psCopy);
+               }
+            }
+            free(psNewArray);
+            return;
+         }
+         ppsBucket = &psNewArray->buckets[psCopy->hash &
+            (psNewArray->numBucketCounts - 1)];
+         psCopy->psNextBinding = *ppsBucket;
+         *ppsBucket = psCopy;
+      }
+   }
+
+   /* the copies are complete before the new array is published */
+   __atomic_store_n(&oSymTable->psArray, psNewArray, __ATOMIC_RELEASE);
+
+   /* readers may still be using the old array and bindings */
+   for (i = 0; i < psOldArray->numBucketCounts; i++) {
+      for (psCurrentBinding = psOldArray->buckets[i];
+         psCurrentBinding != NULL;
+         psCurrentBinding = psCurrentBinding->psNextBinding) {
+
+         psCurrentBinding->retireEpoch = __atomic_load_n(
+            &ulGlobalEpoch, __ATOMIC_SEQ_CST);
+         psCurrentBinding->psNextRetired =
+            oSymTable->psRetiredBindings;
+         oSymTable->psRetiredBindings = psCurrentBinding;
+         oSymTable->numRetired++;
+      }
+   }
+   psOldArray->retireEpoch = __atomic_load_n(&ulGlobalEpoch,
+      __ATOMIC_SEQ_CST);
+   psOldArray->psNextRetired = oSymTable->psRetiredArrays;
+   oSymTable->psRetiredArrays = psOldArray;
+   oSymTable->numRetired++;
+   SymTable_reclaim(oSymTable, 0);
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_new(void) {
+   SymTable_T oSymTable;
+
+   /* allocate new memory */
+   oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
+   if (oSymTable == NULL)
+      return NULL;
+
+   oSymTable->psArray = SymTable_newArray(INITIAL_BUCKET_COUNT);
+   if (oSymTable->psArray == NULL) {
+      free(oSymTable);
+      return NULL;
+   }
+   if (pthread_mutex_init(&oSymTable->mutex, NULL) != 0) {
+      free(oSymTable->psArray);
+      free(oSymTable);
+      return NULL;
+   }
+
+   oSymTable->numBindings = 0;
+   oSymTable->psRetiredBindings = NULL;
+   oSymTable->psRetiredArrays = NULL;
+   oSymTable->numRetired = 0;
+   oSymTable->reclaimAt = RECLAIM_THRESHOLD;
+   return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_free(SymTable_T oSymTable) {
+   struct Binding *psCurrentBinding;
+   struct Binding *psNextBinding;
+   size_t i;
+
+   assert(oSymTable != NULL);
+
+   /* no other thread may be using the table any more */
+   SymTable_reclaim(oSymTable, 1);
+   for (i = 0; i < oSymTable->psArray->numBucketCounts; i++) {
+      for (psCurrentBinding = oSymTable->psArray->buckets[i];
+         psCurrentBinding != NULL;
+         psCurrentBinding = psNextBinding) {
+
+         psNextBinding = psCurrentBinding->psNextBinding;
+         free(psCurrentBinding);
+      }
+   }
+
+   pthread_mutex_destroy(&oSymTable->mutex);
+   free(oSymTable->psArray);
+   free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getLength(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+
+   return __atomic_load_n(&oSymTable->numBindings, __ATOMIC_RELAXED);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the binding of the input oSymTable whose key is pcKey and
+sets *piInserted to 0 (FALSE); if iReplace is nonzero (TRUE), its value
+is first replaced with pvValue. If there is no such binding, adds one
+of pcKey to pvValue, returns it and sets *piInserted to 1 (TRUE). If
+insufficient memory is available, leaves oSymTable unchanged and
+returns NULL. The caller must hold oSymTable's mutex. */
+
+static struct Binding *SymTable_findOrAdd(SymTable_T oSymTable,
+   const char *pcKey, const void *pvValue, int iReplace,
+   int *piInserted) {
+
+   struct Binding *psBinding;
+   struct Binding **ppsBucket;
+   uint64_t hash;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(piInserted != NULL);
+
+   *piInserted = 0;
+
+   hash = SymTable_strhash(pcKey);
+   psBinding = SymTable_find(oSymTable->psArray, pcKey, hash);
+   if (psBinding != NULL) {
+      if (iReplace)
+         __atomic_store_n(&psBinding->value, (void*)pvValue,
+            __ATOMIC_RELEASE);
+      return psBinding;
+   }
+
+   psBinding = SymTable_newBinding(pcKey, strlen(pcKey), hash,
+      pvValue);
+   if (psBinding == NULL)
+      return NULL;
+
+   /* the binding is complete before it is published */
+   ppsBucket = &oSymTable->psArray->buckets[hash &
+      (oSymTable->psArray->numBucketCounts - 1)];
+   psBinding->psNextBinding = *ppsBucket;
+   __atomic_store_n(ppsBucket, psBinding, __ATOMIC_RELEASE);
+   __atomic_store_n(&oSymTable->numBindings, oSymTable->numBindings + 1,
+      __ATOMIC_RELAXED);
+
+   *piInserted = 1;
+
+   /* grow once the average list length passes one binding; that
+   copies psBinding, so the copy is the one to return */
+   if (oSymTable->numBindings > oSymTable->psArray->numBucketCounts) {
+      SymTable_grow(oSymTable);
+      psBinding = SymTable_find(oSymTable->psArray, pcKey, hash);
+   }
+   return psBinding;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_put(SymTable_T oSymTable,
+   const char *pcKey, const void *pvValue) {
+
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   pthread_mutex_lock(&oSymTable->mutex);
+   (void)SymTable_findOrAdd(oSymTable, pcKey, pvValue, 0, &iInserted);
+   pthread_mutex_unlock(&oSymTable->mutex);
+   return iInserted;
+}
+
+/*--------------------------------------------------------------------*/
+
+void **SymTable_findOrInsert(SymTable_T oSymTable, const char *pcKey,
+   const void *pvValue, int *piInserted) {
+
+   struct Binding *psBinding;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   /* the address is only safe to use while no other thread uses the
+   table, since readers load values without a lock */
+   pthread_mutex_lock(&oSymTable->mutex);
+   psBinding = SymTable_findOrAdd(oSymTable, pcKey, pvValue, 0,
+      &iInserted);
+   pthread_mutex_unlock(&oSymTable->mutex);
+   if (piInserted != NULL)
+      *piInserted = iInserted;
+   if (psBinding == NULL)
+      return NULL;
+
+   return &psBinding->value;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_upsert(SymTable_T oSymTable, const char *pcKey,
+   const void *pvValue) {
+
+   struct Binding *psBinding;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   pthread_mutex_lock(&oSymTable->mutex);
+   psBinding = SymTable_findOrAdd(oSymTable, pcKey, pvValue, 1,
+      &iInserted);
+   pthread_mutex_unlock(&oSymTable->mutex);
+   return psBinding != NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_replace(SymTable_T oSymTable,
+   const char *pcKey, const void *pvValue) {
+
+   void* temp = NULL;
+   struct Binding *psCurrentBinding;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   pthread_mutex_lock(&oSymTable->mutex);
+
+   /* find, and if found, replace */
+   psCurrentBinding = SymTable_find(oSymTable->psArray, pcKey,
+      SymTable_strhash(pcKey));
+   if (psCurrentBinding != NULL) {
+      temp = psCurrentBinding->value;
+      __atomic_store_n(&psCurrentBinding->value, (void*)pvValue,
+         __ATOMIC_RELEASE);
+   }
+
+   pthread_mutex_unlock(&oSymTable->mutex);
+   return temp;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the binding of the input oSymTable whose key is pcKey, or
+NULL if there is no such binding, reading without a lock. If iGetValue
+is nonzero (TRUE), also stores the binding's value, or NULL, in
+*ppvValue. */
+
+static struct Binding *SymTable_read(SymTable_T oSymTable,
+   const char *pcKey, int iGetValue, void **ppvValue) {
+
+   struct Reader *psReader;
+   struct Binding *psBinding;
+   uint64_t hash;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   hash = SymTable_strhash(pcKey);
+
+   /* without a record, fall back on the writers' mutex */
+   psReader = SymTable_getReader();
+   if (psReader == NULL)
+      pthread_mutex_lock(&oSymTable->mutex);
+   else
+      SymTable_beginRead(psReader);
+
+   psBinding = SymTable_find(__atomic_load_n(&oSymTable->psArray,
+      __ATOMIC_ACQUIRE), pcKey, hash);
+   if (iGetValue)
+      *ppvValue = psBinding == NULL ? NULL :
+         __atomic_load_n(&psBinding->value, __ATOMIC_ACQUIRE);
+
+   if (psReader == NULL)
+      pthread_mutex_unlock(&oSymTable->mutex);
+   else
+      SymTable_endRead(psReader);
+
+   /* psBinding may be freed from here on; callers only test it */
+   return psBinding;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+   assert (oSymTable != NULL);
+   assert (pcKey != NULL);
+
+   return SymTable_read(oSymTable, pcKey, 0, NULL) != NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+   void *value;
+
+   assert (oSymTable != NULL);
+   assert (pcKey != NULL);
+
+   (void)SymTable_read(oSymTable, pcKey, 1, &value);
+   return value;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+   struct Binding *psCurrentBinding;
+   struct Binding **ppsLink;
+   uint64_t hash;
+   void *temp = NULL;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   hash = SymTable_strhash(pcKey);
+   pthread_mutex_lock(&oSymTable->mutex);
+
+   /* ppsLink is the pointer that leads to psCurrentBinding */
+   for (ppsLink = &oSymTable->psArray->buckets[hash &
+      (oSymTable->psArray->numBucketCounts - 1)];
+      *ppsLink != NULL;
+      ppsLink = &(*ppsLink)->psNextBinding) {
+
+      psCurrentBinding = *ppsLink;
+      if (psCurrentBinding->hash == hash &&
+         strcmp(psCurrentBinding->key, pcKey) == 0) {
+         /* readers see either the binding or its successor */
+         __atomic_store_n(ppsLink, psCurrentBinding->psNextBinding,
+            __ATOMIC_RELEASE);
+         __atomic_store_n(&oSymTable->numBindings,
+            oSymTable->numBindings - 1, __ATOMIC_RELAXED);
+
+         temp = psCurrentBinding->value;
+         SymTable_retireBinding(oSymTable, psCurrentBinding);
+         break;
+      }
+   }
+
+   pthread_mutex_unlock(&oSymTable->mutex);
+   return temp;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_map(SymTable_T oSymTable,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+
+   struct Binding *psCurrentBinding;
+   size_t i;
+
+   assert(oSymTable != NULL);
+   assert(pfApply != NULL);
+
+   /* readers may carry on; writers wait until the map is done, so
+   *pfApply must not change oSymTable */
+   pthread_mutex_lock(&oSymTable->mutex);
+   for (i = 0; i < oSymTable->psArray->numBucketCounts; i++) {
+      for (psCurrentBinding = oSymTable->psArray->buckets[i];
+         psCurrentBinding != NULL;
+         psCurrentBinding = psCurrentBinding->psNextBinding) {
+
+         /* apply the function on each binding */
+         (*pfApply)(psCurrentBinding->key, psCurrentBinding->value,
+            (void*)pvExtra);
+      }
+   }
+   pthread_mutex_unlock(&oSymTable->mutex);
+}
+
+/*--------------------------------------------------------------------*/
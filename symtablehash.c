@@ -3,291 +3,799 @@
 /* Author: Angel Chang Liu                                            */
 /*--------------------------------------------------------------------*/
  
-#include "symtable.h"
+#include "symtablehash.h"
 #include <stdlib.h>
 #include <assert.h>
+#include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
 
 /* valid sizes of auBucketCounts */
-static const size_t auBucketCounts[] = {509, 1021, 2039, 4093, 8191, 
-   16381, 32749, 65521}; 
+static const size_t auBucketCounts[] = {7, 13, 31, 61, 127, 251, 
+   509, 1021, 2039, 4093, 8191, 
+   16381, 32749, 65521, 131071, 262139, 524287, 1048573, 2097143, 
+   4194301, 8388593, 16777213, 33554393, 67108859, 134217689, 
+   268435399, 536870909, 1073741789, 2147483647}; 
+
+/* number of entries in auBucketCounts */
+static const size_t numBucketSizes = 
+   sizeof(auBucketCounts) / sizeof(auBucketCounts[0]);
+
+/* index in auBucketCounts of the 509 buckets SymTable_new starts with;
+smaller sizes are only used by SymTable_newWithCapacity */
+enum {DEFAULT_BUCKET_INDEX = 6};
+
+/* Number of old buckets moved into the new bucket array by each call 
+that advances an expansion. Must be at least 2 so an expansion always 
+finishes before the table is due to expand again. */
+enum {MIGRATE_BUCKETS_PER_CALL = 4};
+
+/* Number of characters that SymTable_hash takes at each step; its 
+steps are written out for 8 */
+enum {HASH_CHUNK_SIZE = 8};
+
+/* Number of keys whose lookups SymTable_getMany interleaves */
+enum {GET_MANY_GROUP_SIZE = 16};
+
+/* Number of buckets that a thread of SymTable_mapParallel claims at a 
+time. Small enough that long lists in one chunk even out across the 
+threads, large enough that claiming chunks costs little. */
+enum {MAP_CHUNK_BUCKETS = 4096};
+
+/* First word of a snapshot file. Being written in the machine's byte 
+order, it also tells apart a snapshot from another kind of machine. */
+#define SNAPSHOT_MAGIC UINT64_C(0x53796d5461626c32)
+
+/* Number of 64-bit words of the header of a snapshot file (magic 
+number, seed and number of bindings) and of the record that starts 
+each binding (hash code, key length and value size) */
+enum {SNAPSHOT_HEADER_WORDS = 3, SNAPSHOT_RECORD_WORDS = 3};
+
+/* Size of the stdio buffer of a snapshot file, so that it is written 
+and read in large sequential blocks, and the initial size of the 
+buffer that holds the bytes of one value */
+enum {SNAPSHOT_BUFFER_SIZE = 1048576, SNAPSHOT_VALUE_SIZE = 64};
+
+/* Number of buckets whose occupancy one word of a bitmap records */
+#define OCCUPIED_BITS (CHAR_BIT * sizeof(size_t))
+
+/* Hint that the memory at p will be read soon */
+#ifdef __GNUC__
+#define PREFETCH(p) __builtin_prefetch(p)
+#else
+#define PREFETCH(p) ((void)(p))
+#endif
 
 /* Each key/value is stored in a Binding. Bindings are linked to form a 
-SymTable */
+SymTable. A Binding and its key are a single allocation. */
 struct Binding { 
-   /* A string that uniquely identifies its binding */
-   char *key; 
-   /* Data that is somehow pertinent to its key */
-   const void* value; 
    /* A node that links the current Node with the next Node */
    struct Binding *psNextBinding; 
+   /* The full hash code of key, before it is reduced to a bucket */
+   uint64_t hash;
+   /* Data that is somehow pertinent to its key */
+   const void* value; 
+   /* The key as handed to callers: key below, or the caller's own 
+   string for an atom, borrowed or owned key */
+   const char *pcKey;
+   /* The number of characters of pcKey, so keys of other lengths are 
+   told apart without reading them; 0 in a table of atoms. Kept to 32 
+   bits so short bindings stay small: keys of UINT32_MAX or more 
+   characters store UINT32_MAX. */
+   uint32_t keyLength;
+   /* Nonzero (TRUE) if pcKey was malloc'd by the caller and handed to 
+   the table, which frees it along with the binding */
+   char ownsKey;
+   /* A string that uniquely identifies its binding, stored inline; 
+   empty if the binding refers to its key through pcKey instead */
+   char key[]; 
 }; 
 
+/* How a new binding holds its key: a copy stored inline, or the 
+caller's string, which it borrows or owns */
+enum KeyStorage {KEY_COPY, KEY_BORROW, KEY_OWN};
+
+/* Bindings are carved out of per-table slabs in multiples of 
+ALLOC_GRAIN bytes. Each multiple is a size class with its own free list 
+of removed bindings. Bindings bigger than the largest class get a block 
+of their own. */
+enum {ALLOC_GRAIN = 16, NUM_SIZE_CLASSES = 16};
+
+/* The first slab of a table holds MIN_SLAB_SIZE bytes, and each later 
+one twice as many as the last, up to MAX_SLAB_SIZE */
+enum {MIN_SLAB_SIZE = 1024, MAX_SLAB_SIZE = 262144};
+
+/* Header of a slab, or of a block holding one oversized binding. The
+memory for bindings follows the header. */
+struct Slab {
+   /* The next slab (or block) of the table */
+   struct Slab *psNextSlab;
+   /* The previous block of the table; unused for slabs */
+   struct Slab *psPrevSlab;
+};
+
+/* Bytes reserved for a slab header, rounded up to keep bindings 
+aligned */
+#define SLAB_HEADER_SIZE \
+   ((sizeof(struct Slab) + ALLOC_GRAIN - 1) / ALLOC_GRAIN * ALLOC_GRAIN)
+
 /* Collection of key value pairs */
 struct SymTable { 
    /* Binding that is a pointer to the first index of the array which
    is a pointer to the first Binding or the beginning of a list */
    struct Binding **buckets; 
+   /* Bitmap with one bit per bucket of buckets, set iff the bucket is 
+   not empty, so iterators can skip empty buckets a word at a time */
+   size_t *occupied;
    /* Stores the number of bindings in a list */
    size_t numBindings;
    /* Stores the number of buckets (array size)*/
    size_t numBucketCounts;
-   /* keeps track of bucket value
-   int bucketIndex; */
+   /* Index of numBucketCounts within auBucketCounts */
+   size_t bucketIndex;
+   /* While an expansion is in progress, the smaller bucket array whose
+   bindings are still being moved into buckets; otherwise NULL */
+   struct Binding **oldBuckets;
+   /* Stores the number of buckets in oldBuckets */
+   size_t numOldBucketCounts;
+   /* Index of the next bucket of oldBuckets to be moved */
+   size_t migrateIndex;
+   /* Random seed that every hash code of this table starts from, and
+   that picks its base */
+   uint64_t seed;
+   /* The powers 0 to HASH_CHUNK_SIZE of the odd base by which
+   SymTable_hash multiplies, drawn from seed */
+   uint64_t auBasePowers[HASH_CHUNK_SIZE + 1];
+   /* The caller's hash function, or NULL to use SymTable_hash */
+   size_t (*pfHash)(const char *pcKey);
+   /* The caller's key comparison function, or NULL to use strcmp */
+   int (*pfEqual)(const char *pcKey1, const char *pcKey2);
+   /* Nonzero (TRUE) if keys are atoms from SymTable_intern, hashed and 
+   compared by address and never copied */
+   int atomKeys;
+   /* Number of bindings whose keys the table owns and must free */
+   size_t numOwnedKeys;
+   /* List of all slabs owned by the table */
+   struct Slab *psSlabs;
+   /* Doubly linked list of blocks holding oversized bindings */
+   struct Slab *psLargeBlocks;
+   /* Start of the unused part of the newest slab */
+   char *pcSlabFree;
+   /* Bytes left in the unused part of the newest slab */
+   size_t slabBytesLeft;
+   /* Size of the next slab to be allocated */
+   size_t nextSlabSize;
+   /* For each size class, removed bindings ready to be reused, linked 
+   through psNextBinding */
+   struct Binding *apsFreeBindings[NUM_SIZE_CLASSES];
 };
 
-/*--------------------------------------------------------------------*/
+/* The work shared by the threads of one SymTable_mapParallel call. 
+The bucket arrays are cut into chunks of MAP_CHUNK_BUCKETS buckets, 
+those of oldBuckets first, and each thread claims the next chunk as 
+soon as it has finished its last one. */
+struct MapJob {
+   /* The table being mapped */
+   SymTable_T oSymTable;
+   /* The function to apply and its extra parameter */
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra);
+   const void *pvExtra;
+   /* Protects nextChunk */
+   pthread_mutex_t mutex;
+   /* Index of the next chunk to be claimed */
+   size_t nextChunk;
+   /* Number of chunks of oldBuckets */
+   size_t numOldChunks;
+   /* Number of chunks of both arrays */
+   size_t numChunks;
+};
 
-/*
-static void expander(SymTable_T oSymTable) {
+/*--------------------------------------------------------------------*/
 
-   struct Binding *psCurrentBinding;
-   size_t i;
-   size_t newHash;
-   struct Binding **newBuckets;
+/* Constants of the hash function, odd with balanced bits */
+static const uint64_t auHashSecret[] = {
+   UINT64_C(0xa0761d6478bd642f), UINT64_C(0xe7037ed1a0b428db),
+   UINT64_C(0x8ebc6af09c88c6e3), UINT64_C(0x589965cc75374cc3)};
 
-   assert(oSymTable != NULL);
+#ifdef __SIZEOF_INT128__
+/* Unsigned 128-bit integers, where the compiler provides them */
+__extension__ typedef unsigned __int128 uint128_type;
+#endif
 
-   comment: go to next bucket size number
-   oSymTable->bucketIndex++;
-   oSymTable->numBucketCounts = auBucketCounts[oSymTable->bucketIndex];
+/* Return the exclusive or of the high and low 64 bits of the 128-bit 
+   product of uA and uB. */
 
-   comment: Allocate new memory
-   newBuckets = (struct Binding**)calloc(oSymTable->numBucketCounts, 
-      sizeof(struct Binding*));
-   if (oSymTable->buckets == NULL) {
-      free(oSymTable);
-      return NULL;
-   }
+static uint64_t SymTable_mix(uint64_t uA, uint64_t uB)
+{
+#ifdef __SIZEOF_INT128__
+   uint128_type uProduct = (uint128_type)uA * uB;
+   return (uint64_t)uProduct ^ (uint64_t)(uProduct >> 64);
+#else
+   uint64_t uLoLo, uLoHi, uHiLo, uHiHi, uMiddle;
+   uLoLo = (uA & 0xffffffffU) * (uB & 0xffffffffU);
+   uLoHi = (uA & 0xffffffffU) * (uB >> 32);
+   uHiLo = (uA >> 32) * (uB & 0xffffffffU);
+   uHiHi = (uA >> 32) * (uB >> 32);
+   uMiddle = (uLoLo >> 32) + (uLoHi & 0xffffffffU) + 
+      (uHiLo & 0xffffffffU);
+   return ((uLoLo & 0xffffffffU) | (uMiddle << 32)) ^
+      (uHiHi + (uLoHi >> 32) + (uHiLo >> 32) + (uMiddle >> 32));
+#endif
+}
 
+/*--------------------------------------------------------------------*/
 
+/* Return a 64-bit hash code for the keyLength characters at pcKey in 
+   the input oSymTable. This is the classic polynomial hash, which the 
+   65599 loop computes one character at a time, but with the table's 
+   own random odd base and with its seed as the leading term. Keys 
+   that differ only in their last character, like "1234" and "1235", 
+   get hash codes that differ by as little, so they land in nearby 
+   buckets and a run of such keys is cache friendly. Which other keys 
+   collide depends on the base, which callers cannot know. The key is 
+   taken HASH_CHUNK_SIZE characters per step, whose products with the 
+   powers of the base do not depend on each other and so are computed 
+   side by side. The hash is stored in the key's binding and reduced 
+   to a bucket by SymTable_bucket. */
+
+static uint64_t SymTable_hash(SymTable_T oSymTable, const char *pcKey,
+   size_t keyLength)
+{
+   const unsigned char *pc = (const unsigned char*)pcKey;
+   const unsigned char *pcEnd = pc + keyLength;
+   const uint64_t *auP;
+   uint64_t uHash;
 
-   comment: Rehash all objects
-   for (i = 0; i < oSymTable->numBucketCounts; i++) {
-      psCurrentBinding = oSymTable->buckets[i];
-      oSymTable->buckets = newBuckets;
-     
-      while (psCurrentBinding != NULL) {
-         newHash = SymTable_hash(psCurrentBinding->key, 
-            oSymTable->numBucketCounts);
-         newBuckets[newHash] = psCurrentBinding;
-         psCurrentBinding = psCurrentBinding->psNextBinding;
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
 
-      }
+   auP = oSymTable->auBasePowers;
+   uHash = oSymTable->seed;
+
+   /* the first keyLength % HASH_CHUNK_SIZE characters */
+   switch (keyLength % HASH_CHUNK_SIZE) {
+      case 7: uHash = uHash * auP[1] + *pc++; /* fall through */
+      case 6: uHash = uHash * auP[1] + *pc++; /* fall through */
+      case 5: uHash = uHash * auP[1] + *pc++; /* fall through */
+      case 4: uHash = uHash * auP[1] + *pc++; /* fall through */
+      case 3: uHash = uHash * auP[1] + *pc++; /* fall through */
+      case 2: uHash = uHash * auP[1] + *pc++; /* fall through */
+      case 1: uHash = uHash * auP[1] + *pc++; /* fall through */
+      default: break;
    }
 
-   free(oSymTable);
+   /* the rest in whole chunks */
+   for (; pc < pcEnd; pc += HASH_CHUNK_SIZE)
+      uHash = uHash * auP[8] + pc[0] * auP[7] + pc[1] * auP[6] + 
+         pc[2] * auP[5] + pc[3] * auP[4] + pc[4] * auP[3] + 
+         pc[5] * auP[2] + pc[6] * auP[1] + pc[7];
+   return uHash;
 }
 
-*/
+/*--------------------------------------------------------------------*/
+
+/* Return the bucket, between 0 and numBucketCounts-1, of a key whose 
+   hash code is hash. numBucketCounts is a prime, so all the bits of 
+   hash count, and hash codes that are close give buckets that are 
+   close. */
+
+static size_t SymTable_bucket(uint64_t hash, size_t numBucketCounts)
+{
+   return (size_t)(hash % numBucketCounts);
+}
 
 /*--------------------------------------------------------------------*/
 
+/* Return a seed for a new table. Mixes the clock, the table's address 
+   and a counter, so that different tables, and different runs, hash 
+   keys differently and no fixed set of keys always collides. Threads 
+   may create tables at the same time, so the counter is advanced 
+   under a lock. */
+
+static uint64_t SymTable_newSeed(const void *pvTable)
+{
+   static pthread_mutex_t counterMutex = PTHREAD_MUTEX_INITIALIZER;
+   static uint64_t uCounter = 0;
+   uint64_t uCount;
+   uint64_t uEntropy;
+
+   pthread_mutex_lock(&counterMutex);
+   uCounter += auHashSecret[2];
+   uCount = uCounter;
+   pthread_mutex_unlock(&counterMutex);
+
+   uEntropy = (uint64_t)time(NULL) ^ ((uint64_t)clock() << 32) ^ 
+      (uint64_t)(size_t)pvTable;
+   return SymTable_mix(uEntropy ^ auHashSecret[3], 
+      uCount ^ auHashSecret[0]);
+}
+
+/*--------------------------------------------------------------------*/
 
-/* Return a hash code for pcKey that is between 0 and uBucketCount-1,
-   inclusive. */
+/* Set the seed of the input oSymTable to seed, and its base, an odd 
+   number drawn from seed, along with it. */
 
-static size_t SymTable_hash(const char *pcKey, size_t uBucketCount)
+static void SymTable_setSeed(SymTable_T oSymTable, uint64_t seed)
 {
-   const size_t HASH_MULTIPLIER = 65599;
+   uint64_t uBase;
    size_t u;
-   size_t uHash = 0;
-
-   assert(pcKey != NULL);
 
-   for (u = 0; pcKey[u] != '\0'; u++)
-      uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+   assert(oSymTable != NULL);
 
-   return uHash % uBucketCount;
+   uBase = SymTable_mix(seed ^ auHashSecret[2], auHashSecret[1]) | 1;
+   oSymTable->seed = seed;
+   oSymTable->auBasePowers[0] = 1;
+   for (u = 1; u <= HASH_CHUNK_SIZE; u++)
+      oSymTable->auBasePowers[u] = oSymTable->auBasePowers[u - 1] * 
+         uBase;
 }
 
 /*--------------------------------------------------------------------*/
- 
-SymTable_T SymTable_new(void) {
-   SymTable_T oSymTable;
 
-   /* allocate new memory */
-   oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
-   if (oSymTable == NULL)
-      return NULL;
-      
-   oSymTable->numBucketCounts = auBucketCounts[0];
+/* Returns the size class of a binding whose key has keyLength 
+characters. Class c holds bindings of up to (c+1)*ALLOC_GRAIN bytes. 
+Classes 0 to NUM_SIZE_CLASSES-1 come from slabs; any larger class means 
+the binding needs a block of its own. */
 
-   /* allocate new memory */
-   oSymTable->buckets = (struct Binding**)calloc(oSymTable->
-      numBucketCounts, sizeof(struct Binding*));
-   if (oSymTable->buckets == NULL) {
-      free(oSymTable);
-      return NULL;
-   }
+static size_t SymTable_sizeClass(size_t keyLength) {
+   /* the binding needs offsetof(struct Binding, key) + keyLength + 1 
+   bytes, which is never less than sizeof(struct Binding) once 
+   rounded up */
+   return (offsetof(struct Binding, key) + keyLength) / ALLOC_GRAIN;
+}
 
-   /* comment: for expander
-   oSymTable->bucketIndex = 0; */
-   oSymTable->numBindings = 0;
+/*--------------------------------------------------------------------*/
 
-   return oSymTable;
+/* Carves a binding of size class sizeClass out of the newest slab of 
+the input oSymTable, which must have room for it, and puts it on the 
+free list of its class, as if it had been removed. */
+
+static void SymTable_carveFree(SymTable_T oSymTable, size_t sizeClass) {
+   struct Binding *psBinding;
 
+   assert(oSymTable != NULL);
+   assert(sizeClass < NUM_SIZE_CLASSES);
+   assert((sizeClass + 1) * ALLOC_GRAIN <= oSymTable->slabBytesLeft);
+
+   psBinding = (struct Binding*)(void*)oSymTable->pcSlabFree;
+   psBinding->psNextBinding = oSymTable->apsFreeBindings[sizeClass];
+   oSymTable->apsFreeBindings[sizeClass] = psBinding;
+   oSymTable->pcSlabFree += (sizeClass + 1) * ALLOC_GRAIN;
+   oSymTable->slabBytesLeft -= (sizeClass + 1) * ALLOC_GRAIN;
 }
 
 /*--------------------------------------------------------------------*/
 
-void SymTable_free(SymTable_T oSymTable) {
-   struct Binding *psCurrentBinding;
-   struct Binding *psNextBinding;
-   /* index to iterate through buckets */
-   size_t i;
+/* Puts what is left of the newest slab of the input oSymTable on the 
+free lists, as bindings of the largest size classes that fit, so that 
+it is used rather than lost once a new slab is started. Only a piece 
+too small for any binding is left over. */
+
+static void SymTable_retireSlabTail(SymTable_T oSymTable) {
+   size_t minSizeClass;
+   size_t sizeClass;
 
    assert(oSymTable != NULL);
 
-   /* iterate through all bindings */
-   for (i = 0; i < oSymTable->numBucketCounts; i++) {
-      psCurrentBinding = oSymTable->buckets[i];
-      while (psCurrentBinding != NULL) {
-         psNextBinding = psCurrentBinding->psNextBinding;
-         free(psCurrentBinding->key);
-         free(psCurrentBinding);
-         psCurrentBinding = psNextBinding;
-      }
+   minSizeClass = SymTable_sizeClass(0);
+   while (oSymTable->slabBytesLeft / ALLOC_GRAIN > minSizeClass) {
+      sizeClass = oSymTable->slabBytesLeft / ALLOC_GRAIN - 1;
+      if (sizeClass >= NUM_SIZE_CLASSES)
+         sizeClass = NUM_SIZE_CLASSES - 1;
+      SymTable_carveFree(oSymTable, sizeClass);
    }
-   free(oSymTable->buckets);
-   free(oSymTable);
 }
 
 /*--------------------------------------------------------------------*/
 
-size_t SymTable_getLength(SymTable_T oSymTable) {
+/* Makes sure the newest slab of the input oSymTable has at least 
+numBytes bytes left, so that bindings totalling that size are carved 
+out of one slab. What is left of the slab it replaces goes to the free 
+lists. Returns 1 (TRUE) on success, or 0 (FALSE) if insufficient 
+memory is available. */
+
+static int SymTable_reserveSlab(SymTable_T oSymTable, size_t numBytes) {
+   struct Slab *psSlab;
+   size_t slabSize;
+
    assert(oSymTable != NULL);
 
-   return oSymTable->numBindings;
+   if (oSymTable->slabBytesLeft >= numBytes)
+      return 1;
+
+   slabSize = oSymTable->nextSlabSize;
+   if (slabSize < numBytes)
+      slabSize = numBytes;
+   psSlab = (struct Slab*)malloc(SLAB_HEADER_SIZE + slabSize);
+   if (psSlab == NULL)
+      return 0;
+   psSlab->psNextSlab = oSymTable->psSlabs;
+   psSlab->psPrevSlab = NULL;
+   oSymTable->psSlabs = psSlab;
+   SymTable_retireSlabTail(oSymTable);
+   oSymTable->pcSlabFree = (char*)psSlab + SLAB_HEADER_SIZE;
+   oSymTable->slabBytesLeft = slabSize;
+   if (oSymTable->nextSlabSize < MAX_SLAB_SIZE)
+      oSymTable->nextSlabSize *= 2;
+   return 1;
 }
 
 /*--------------------------------------------------------------------*/
 
-int SymTable_put(SymTable_T oSymTable,
-   const char *pcKey, const void *pvValue) {
-   
-   struct Binding *psNewBinding;
-   struct Binding *psCurrentBinding;
-   size_t hash;
-   char *newKey;
+/* Returns memory from the input oSymTable's allocator for a binding 
+whose key has keyLength characters, or NULL if insufficient memory is 
+available. Reuses a removed binding of the same size class if there is 
+one, and otherwise carves the binding out of the newest slab. */
 
-   assert(oSymTable != NULL);
-   assert(pcKey != NULL);
+static struct Binding *SymTable_allocBinding(SymTable_T oSymTable,
+   size_t keyLength) {
 
-   hash = SymTable_hash(pcKey, oSymTable->numBucketCounts);
+   struct Binding *psBinding;
+   struct Slab *psSlab;
+   size_t sizeClass;
+   size_t size;
 
-   /* check if present already */
-   for (psCurrentBinding = oSymTable->buckets[hash];  
-      psCurrentBinding != NULL;
-      psCurrentBinding = psCurrentBinding->psNextBinding) {
+   assert(oSymTable != NULL);
 
-      if (strcmp(psCurrentBinding->key, pcKey) == 0) {
-         return 0;
-      }
+   sizeClass = SymTable_sizeClass(keyLength);
+   size = (sizeClass + 1) * ALLOC_GRAIN;
+
+   /* oversized bindings get their own block */
+   if (sizeClass >= NUM_SIZE_CLASSES) {
+      psSlab = (struct Slab*)malloc(SLAB_HEADER_SIZE + size);
+      if (psSlab == NULL)
+         return NULL;
+      psSlab->psPrevSlab = NULL;
+      psSlab->psNextSlab = oSymTable->psLargeBlocks;
+      if (oSymTable->psLargeBlocks != NULL)
+         oSymTable->psLargeBlocks->psPrevSlab = psSlab;
+      oSymTable->psLargeBlocks = psSlab;
+      return (struct Binding*)(void*)((char*)psSlab + SLAB_HEADER_SIZE);
    }
 
-   /* calls expander if max numBucketCount reached
-   if (oSymTable->bucketIndex > oSymTable->numBucketCounts) {
-      expander(oSymTable);
+   /* reuse a removed binding if possible */
+   psBinding = oSymTable->apsFreeBindings[sizeClass];
+   if (psBinding != NULL) {
+      oSymTable->apsFreeBindings[sizeClass] = psBinding->psNextBinding;
+      return psBinding;
    }
-   */
 
-  /* allocating new memory and rebinding */
-   newKey = (char*)malloc(strlen(pcKey) + 1);
-   if (newKey == NULL)
-         return 0;
-   strcpy(newKey, pcKey);
+   /* start a new slab when the newest one is used up */
+   if (! SymTable_reserveSlab(oSymTable, size))
+      return NULL;
 
-   psNewBinding = (struct Binding*)malloc(sizeof(struct Binding));
-   if (psNewBinding == NULL) {
-         free(newKey);
-         return 0;
+   psBinding = (struct Binding*)(void*)oSymTable->pcSlabFree;
+   oSymTable->pcSlabFree += size;
+   oSymTable->slabBytesLeft -= size;
+   return psBinding;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the memory of psBinding, which must have come from 
+SymTable_allocBinding for the input oSymTable, to the table's 
+allocator. */
+
+static void SymTable_freeBinding(SymTable_T oSymTable,
+   struct Binding *psBinding) {
+
+   struct Slab *psSlab;
+   size_t sizeClass;
+
+   assert(oSymTable != NULL);
+   assert(psBinding != NULL);
+
+   if (psBinding->pcKey != psBinding->key)
+      sizeClass = SymTable_sizeClass(0);
+   else if (psBinding->keyLength < UINT32_MAX)
+      sizeClass = SymTable_sizeClass(psBinding->keyLength);
+   else
+      sizeClass = SymTable_sizeClass(strlen(psBinding->key));
+
+   /* recycle slab memory through the free list of its size class */
+   if (sizeClass < NUM_SIZE_CLASSES) {
+      psBinding->psNextBinding = oSymTable->apsFreeBindings[sizeClass];
+      oSymTable->apsFreeBindings[sizeClass] = psBinding;
+      return;
    }
-   psNewBinding->psNextBinding = oSymTable->buckets[hash];
-   oSymTable->buckets[hash] = psNewBinding;
 
-   psNewBinding->key = newKey;
+   /* unlink and release an oversized binding's block */
+   psSlab = (struct Slab*)(void*)((char*)psBinding - SLAB_HEADER_SIZE);
+   if (psSlab->psPrevSlab != NULL)
+      psSlab->psPrevSlab->psNextSlab = psSlab->psNextSlab;
+   else
+      oSymTable->psLargeBlocks = psSlab->psNextSlab;
+   if (psSlab->psNextSlab != NULL)
+      psSlab->psNextSlab->psPrevSlab = psSlab->psPrevSlab;
+   free(psSlab);
+}
 
-   psNewBinding->value = (void*)pvValue;
+/*--------------------------------------------------------------------*/
 
-   oSymTable->numBindings++;
+/* Frees every slab or block of the list that begins with psSlab. */
 
-   /* comment: for expander to keep track of where in the bucket it is
-   oSymTable->bucketIndex++; */
+static void SymTable_freeSlabs(struct Slab *psSlab) {
+   struct Slab *psNextSlab;
 
-   return 1;
+   while (psSlab != NULL) {
+      psNextSlab = psSlab->psNextSlab;
+      free(psSlab);
+      psSlab = psNextSlab;
+   }
 }
 
+/*--------------------------------------------------------------------*/
+
+/* Returns the number of characters of pcKey that a binding of the 
+input oSymTable stores inline: all of them, or none in a table of 
+atoms. */
+
+static size_t SymTable_keyLength(SymTable_T oSymTable, 
+   const char *pcKey) {
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   return oSymTable->atomKeys ? 0 : strlen(pcKey);
+}
 
 /*--------------------------------------------------------------------*/
 
-void *SymTable_replace(SymTable_T oSymTable,
-   const char *pcKey, const void *pvValue) {
-   
-   void* temp;
-   struct Binding *psCurrentBinding;
+/* Return the hash code in the input oSymTable of pcKey, whose length 
+is keyLength, using the table's own hash function if it has one. A 
+table of atoms hashes the address alone. */
+
+static uint64_t SymTable_hashKey(SymTable_T oSymTable, const char *pcKey,
+   size_t keyLength) {
 
    assert(oSymTable != NULL);
    assert(pcKey != NULL);
-   
-   /* iterate to find */
-   for (psCurrentBinding = oSymTable->buckets[(SymTable_hash(pcKey, 
-      oSymTable->numBucketCounts))];
-      psCurrentBinding != NULL;
-      psCurrentBinding = psCurrentBinding->psNextBinding) {
-      /* if found, replace */
-      if (strcmp(psCurrentBinding->key, pcKey) == 0) {
-         temp = (void*)psCurrentBinding->value;
-         psCurrentBinding->value = pvValue;
-         return temp;
-      }
-   }
-   return NULL;
+
+   if (oSymTable->atomKeys)
+      return SymTable_mix((uint64_t)(uintptr_t)pcKey ^ oSymTable->seed, 
+         auHashSecret[1]);
+   if (oSymTable->pfHash == NULL)
+      return SymTable_hash(oSymTable, pcKey, keyLength);
+
+   /* seed and spread the caller's hash code */
+   return SymTable_mix((uint64_t)(*oSymTable->pfHash)(pcKey) ^ 
+      oSymTable->seed, auHashSecret[1]);
 }
 
 /*--------------------------------------------------------------------*/
 
-int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
-   
+/* Returns 1 (TRUE) if the key of psBinding equals pcKey, whose length 
+is keyLength, under the input oSymTable's key comparison, and 0 (FALSE) 
+otherwise. Tables without their own comparison function compare the 
+lengths and then the characters with memcmp, and tables of atoms 
+compare addresses. */
+
+static int SymTable_equal(SymTable_T oSymTable, 
+   const struct Binding *psBinding, const char *pcKey, 
+   size_t keyLength) {
+
+   assert(oSymTable != NULL);
+   assert(psBinding != NULL);
+   assert(pcKey != NULL);
+
+   if (oSymTable->atomKeys)
+      return psBinding->pcKey == pcKey;
+   if (oSymTable->pfEqual != NULL)
+      return (*oSymTable->pfEqual)(psBinding->pcKey, pcKey) != 0;
+   if (keyLength < UINT32_MAX)
+      return psBinding->keyLength == keyLength && 
+         memcmp(psBinding->pcKey, pcKey, keyLength) == 0;
+
+   /* a key too long for its length to be stored */
+   return psBinding->keyLength == UINT32_MAX &&
+      strncmp(psBinding->pcKey, pcKey, keyLength) == 0 &&
+      psBinding->pcKey[keyLength] == '\0';
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a bitmap with room for one bit per bucket of numBucketCounts 
+buckets, all clear, or NULL if insufficient memory is available. */
+
+static size_t *SymTable_newOccupied(size_t numBucketCounts) {
+   return (size_t*)calloc((numBucketCounts + OCCUPIED_BITS - 1) / 
+      OCCUPIED_BITS, sizeof(size_t));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Record in the input oSymTable's occupancy bitmap whether its bucket
+is empty, after a binding has been added to or removed from it. */
+
+static void SymTable_setOccupied(SymTable_T oSymTable, size_t bucket) {
+   size_t uBit;
+
+   assert(oSymTable != NULL);
+   assert(bucket < oSymTable->numBucketCounts);
+
+   uBit = (size_t)1 << (bucket % OCCUPIED_BITS);
+   if (oSymTable->buckets[bucket] != NULL)
+      oSymTable->occupied[bucket / OCCUPIED_BITS] |= uBit;
+   else
+      oSymTable->occupied[bucket / OCCUPIED_BITS] &= ~uBit;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the index of the lowest set bit of uWord, which must not be 
+0. */
+
+static size_t SymTable_lowestBit(size_t uWord) {
+#ifdef __GNUC__
+   return (size_t)__builtin_ctzll((unsigned long long)uWord);
+#else
+   size_t i;
+
+   assert(uWord != 0);
+
+   for (i = 0; (uWord & 1) == 0; i++)
+      uWord >>= 1;
+   return i;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Move up to MIGRATE_BUCKETS_PER_CALL buckets of the input oSymTable's
+oldBuckets into its current buckets, and release oldBuckets once it is
+empty. Does nothing if no expansion is in progress. */
+
+static void SymTable_migrate(SymTable_T oSymTable) {
    struct Binding *psCurrentBinding;
+   struct Binding *psNextBinding;
+   size_t bucket;
+   size_t uMoved;
 
-   assert (oSymTable != NULL);
-   assert (pcKey != NULL);
+   assert(oSymTable != NULL);
 
-   oSymTable->numBucketCounts = auBucketCounts[0];
+   if (oSymTable->oldBuckets == NULL)
+      return;
 
-   /* check if present through iteration */
-   for (psCurrentBinding = oSymTable->buckets[(SymTable_hash(pcKey, 
-      oSymTable->numBucketCounts))];
-      psCurrentBinding != NULL;
-      psCurrentBinding = psCurrentBinding->psNextBinding) {
+   for (uMoved = 0; uMoved < MIGRATE_BUCKETS_PER_CALL &&
+      oSymTable->migrateIndex < oSymTable->numOldBucketCounts; 
+      uMoved++) {
 
-      if (strcmp(psCurrentBinding->key, pcKey) == 0) {
-         return 1;
+      /* relink every binding of this old bucket into the new array */
+      psCurrentBinding = oSymTable->oldBuckets[oSymTable->migrateIndex];
+      while (psCurrentBinding != NULL) {
+         psNextBinding = psCurrentBinding->psNextBinding;
+         /* the cached hash spares rehashing the key */
+         bucket = SymTable_bucket(psCurrentBinding->hash, 
+            oSymTable->numBucketCounts);
+         psCurrentBinding->psNextBinding = oSymTable->buckets[bucket];
+         oSymTable->buckets[bucket] = psCurrentBinding;
+         SymTable_setOccupied(oSymTable, bucket);
+         psCurrentBinding = psNextBinding;
       }
+      oSymTable->oldBuckets[oSymTable->migrateIndex] = NULL;
+      oSymTable->migrateIndex++;
+   }
+
+   if (oSymTable->migrateIndex == oSymTable->numOldBucketCounts) {
+      free(oSymTable->oldBuckets);
+      oSymTable->oldBuckets = NULL;
+      oSymTable->numOldBucketCounts = 0;
+      oSymTable->migrateIndex = 0;
    }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Begin expanding the input oSymTable to auBucketCounts[newIndex] 
+buckets. The bindings are moved over gradually by later calls of 
+SymTable_migrate, so no single call pays for a full rehash. Returns 1 
+(TRUE) if the table has at least that many buckets afterwards, or 0 
+(FALSE) and leaves the table at its current size if insufficient 
+memory is available. */
+
+static int SymTable_expand(SymTable_T oSymTable, size_t newIndex) {
+   struct Binding **newBuckets;
+   size_t *newOccupied;
+   size_t newBucketCount;
+
+   assert(oSymTable != NULL);
+   assert(newIndex < numBucketSizes);
+
+   if (newIndex <= oSymTable->bucketIndex)
+      return 1;
+
+   /* an earlier expansion must be finished before starting another */
+   while (oSymTable->oldBuckets != NULL)
+      SymTable_migrate(oSymTable);
+
+   newBucketCount = auBucketCounts[newIndex];
+   newBuckets = (struct Binding**)calloc(newBucketCount, 
+      sizeof(struct Binding*));
+   if (newBuckets == NULL)
       return 0;
+   newOccupied = SymTable_newOccupied(newBucketCount);
+   if (newOccupied == NULL) {
+      free(newBuckets);
+      return 0;
+   }
+
+   /* only the current bucket array needs a bitmap */
+   free(oSymTable->occupied);
+   oSymTable->occupied = newOccupied;
+
+   /* an empty table has nothing to move */
+   if (oSymTable->numBindings == 0)
+      free(oSymTable->buckets);
+   else {
+      oSymTable->oldBuckets = oSymTable->buckets;
+      oSymTable->numOldBucketCounts = oSymTable->numBucketCounts;
+      oSymTable->migrateIndex = 0;
+   }
+
+   oSymTable->buckets = newBuckets;
+   oSymTable->numBucketCounts = newBucketCount;
+   oSymTable->bucketIndex = newIndex;
+   return 1;
 }
 
 /*--------------------------------------------------------------------*/
 
-void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+/* Returns the index of the smallest size in auBucketCounts that holds 
+numBindings bindings without expanding, or of the largest size if 
+there is none. */
+
+static size_t SymTable_indexFor(size_t numBindings) {
+   size_t i;
+
+   for (i = 0; i + 1 < numBucketSizes; i++)
+      if (auBucketCounts[i] >= numBindings)
+         break;
+   return i;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the binding of the input oSymTable whose key is pcKey, or 
+NULL if no such binding exists. keyLength and hash must be the length 
+and hash code of pcKey. 
+Looks in oldBuckets as well while an expansion is in progress. Keys are 
+only compared when the cached hashes are equal. */
+
+static struct Binding *SymTable_find(SymTable_T oSymTable, 
+   const char *pcKey, size_t keyLength, uint64_t hash) {
 
    struct Binding *psCurrentBinding;
 
-   assert (oSymTable != NULL);
-   assert (pcKey != NULL);
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   for (psCurrentBinding = oSymTable->buckets[
+      SymTable_bucket(hash, oSymTable->numBucketCounts)];
+      psCurrentBinding != NULL;
+      psCurrentBinding = psCurrentBinding->psNextBinding) {
+
+      if (psCurrentBinding->hash == hash && 
+         SymTable_equal(oSymTable, psCurrentBinding, pcKey, 
+            keyLength)) {
+         return psCurrentBinding;
+      }
+   }
 
-   oSymTable->numBucketCounts = auBucketCounts[0];
+   if (oSymTable->oldBuckets == NULL)
+      return NULL;
 
-   /* iterate to find the correct binding */
-   for (psCurrentBinding = oSymTable->buckets[(SymTable_hash(pcKey, 
-      oSymTable->numBucketCounts))];
+   for (psCurrentBinding = oSymTable->oldBuckets[
+      SymTable_bucket(hash, oSymTable->numOldBucketCounts)];
       psCurrentBinding != NULL;
       psCurrentBinding = psCurrentBinding->psNextBinding) {
 
-      if (strcmp(psCurrentBinding->key, pcKey) == 0) {
-         return (void*)psCurrentBinding->value;
+      if (psCurrentBinding->hash == hash && 
+         SymTable_equal(oSymTable, psCurrentBinding, pcKey, 
+            keyLength)) {
+         return psCurrentBinding;
       }
    }
    return NULL;
@@ -295,42 +803,39 @@ void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
 
 /*--------------------------------------------------------------------*/
 
-void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+/* Unlinks the binding whose key is pcKey from the list of the input 
+oSymTable whose first binding is *ppsFirstBinding and returns it, or 
+returns NULL if the list has no such binding. keyLength and hash must 
+be the length and hash code of pcKey. */
+
+static struct Binding *SymTable_unlink(SymTable_T oSymTable, 
+   struct Binding **ppsFirstBinding, const char *pcKey, 
+   size_t keyLength, uint64_t hash) {
 
-   void* temp;
    struct Binding *psCurrentBinding;
    struct Binding *psPreviousBinding;
-   size_t hash;
 
    assert(oSymTable != NULL);
+   assert(ppsFirstBinding != NULL);
    assert(pcKey != NULL);
 
-   hash = SymTable_hash(pcKey, oSymTable->numBucketCounts);
    psPreviousBinding = NULL;
 
-   /* checks if present */
-   for (psCurrentBinding = oSymTable->buckets[hash];  
+   for (psCurrentBinding = *ppsFirstBinding;  
       psCurrentBinding != NULL;
       psCurrentBinding = psCurrentBinding->psNextBinding) {
 
-      if (strcmp(psCurrentBinding->key, pcKey) == 0) {
-         /* save old value, relink list, decrease count, return old 
-            value */
-         temp = (void*)psCurrentBinding->value;
+      if (psCurrentBinding->hash == hash && 
+         SymTable_equal(oSymTable, psCurrentBinding, pcKey, 
+            keyLength)) {
          if (psPreviousBinding == NULL) {
-            oSymTable->buckets[hash] = psCurrentBinding->psNextBinding;
+            *ppsFirstBinding = psCurrentBinding->psNextBinding;
          }
          else {
             psPreviousBinding->psNextBinding = psCurrentBinding->
                psNextBinding;
          }
-
-         free(psCurrentBinding->key);
-         free(psCurrentBinding);
-
-         oSymTable->numBindings--;
-
-         return temp;
+         return psCurrentBinding;
       }
 
       psPreviousBinding = psCurrentBinding;
@@ -340,32 +845,1359 @@ void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
 }
 
 /*--------------------------------------------------------------------*/
+ 
+/* Returns a new SymTable object that contains no bindings, has 
+auBucketCounts[bucketIndex] buckets, and hashes and compares keys with 
+*pfHash and *pfEqual (see SymTable_newWithOps), or NULL if insufficient 
+memory is available. */
 
-void SymTable_map(SymTable_T oSymTable,
-   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
-   const void *pvExtra) {
-   
-   struct Binding *psCurrentBinding;
-   size_t i;
+static SymTable_T SymTable_create(size_t (*pfHash)(const char *pcKey),
+   int (*pfEqual)(const char *pcKey1, const char *pcKey2), 
+   size_t bucketIndex) {
 
-   const char *key;
-   void* value;
+   SymTable_T oSymTable;
+   size_t i;
 
-   assert(oSymTable != NULL);
-   assert(pfApply != NULL);
+   assert(bucketIndex < numBucketSizes);
 
-   oSymTable->numBucketCounts = auBucketCounts[0];
+   /* allocate new memory */
+   oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
+   if (oSymTable == NULL)
+      return NULL;
+      
+   oSymTable->bucketIndex = bucketIndex;
+   oSymTable->numBucketCounts = auBucketCounts[bucketIndex];
 
-   for (i = 0; i < oSymTable->numBucketCounts; i++) {
-      psCurrentBinding = oSymTable->buckets[i];
-      while (psCurrentBinding != NULL) {
-         key = psCurrentBinding->key;
-         value = (void*)psCurrentBinding->value;
-         /* apply the function on each binding */
-         (*pfApply)(key, value, (void*)pvExtra);
-         psCurrentBinding = psCurrentBinding->psNextBinding;
-      }
+   /* allocate new memory */
+   oSymTable->buckets = (struct Binding**)calloc(oSymTable->
+      numBucketCounts, sizeof(struct Binding*));
+   if (oSymTable->buckets == NULL) {
+      free(oSymTable);
+      return NULL;
    }
-}
-
-/*--------------------------------------------------------------------*/
\ No newline at end of file
+   oSymTable->occupied = SymTable_newOccupied(oSymTable->
+      numBucketCounts);
+   if (oSymTable->occupied == NULL) {
+      free(oSymTable->buckets);
+      free(oSymTable);
+      return NULL;
+   }
+
+   oSymTable->oldBuckets = NULL;
+   oSymTable->numOldBucketCounts = 0;
+   oSymTable->migrateIndex = 0;
+   oSymTable->numBindings = 0;
+   SymTable_setSeed(oSymTable, SymTable_newSeed(oSymTable));
+   oSymTable->pfHash = pfHash;
+   oSymTable->pfEqual = pfEqual;
+   oSymTable->atomKeys = 0;
+   oSymTable->numOwnedKeys = 0;
+
+   oSymTable->psSlabs = NULL;
+   oSymTable->psLargeBlocks = NULL;
+   oSymTable->pcSlabFree = NULL;
+   oSymTable->slabBytesLeft = 0;
+   oSymTable->nextSlabSize = MIN_SLAB_SIZE;
+   for (i = 0; i < NUM_SIZE_CLASSES; i++)
+      oSymTable->apsFreeBindings[i] = NULL;
+
+   return oSymTable;
+
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_new(void) {
+   return SymTable_create(NULL, NULL, DEFAULT_BUCKET_INDEX);
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_newWithOps(size_t (*pfHash)(const char *pcKey),
+   int (*pfEqual)(const char *pcKey1, const char *pcKey2)) {
+
+   return SymTable_create(pfHash, pfEqual, DEFAULT_BUCKET_INDEX);
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_newWithCapacity(size_t uCapacity) {
+   return SymTable_create(NULL, NULL, SymTable_indexFor(uCapacity));
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_newForAtoms(void) {
+   SymTable_T oSymTable;
+
+   oSymTable = SymTable_create(NULL, NULL, DEFAULT_BUCKET_INDEX);
+   if (oSymTable != NULL)
+      oSymTable->atomKeys = 1;
+   return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_reserve(SymTable_T oSymTable, size_t uCapacity) {
+   assert(oSymTable != NULL);
+
+   return SymTable_expand(oSymTable, SymTable_indexFor(uCapacity));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Frees the keys that the bindings in the numBucketCounts lists of 
+the input buckets array own. */
+
+static void SymTable_freeOwnedKeys(struct Binding **buckets,
+   size_t numBucketCounts) {
+
+   struct Binding *psCurrentBinding;
+   size_t i;
+
+   assert(buckets != NULL);
+
+   for (i = 0; i < numBucketCounts; i++)
+      for (psCurrentBinding = buckets[i]; psCurrentBinding != NULL;
+         psCurrentBinding = psCurrentBinding->psNextBinding)
+         if (psCurrentBinding->ownsKey)
+            free((char*)psCurrentBinding->pcKey);
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_free(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+
+   /* only owned keys need the lists to be walked */
+   if (oSymTable->numOwnedKeys > 0) {
+      SymTable_freeOwnedKeys(oSymTable->buckets, 
+         oSymTable->numBucketCounts);
+      if (oSymTable->oldBuckets != NULL)
+         SymTable_freeOwnedKeys(oSymTable->oldBuckets, 
+            oSymTable->numOldBucketCounts);
+   }
+
+   /* every binding lives in a slab or block, so there is no need to 
+   walk the lists otherwise */
+   SymTable_freeSlabs(oSymTable->psSlabs);
+   SymTable_freeSlabs(oSymTable->psLargeBlocks);
+   free(oSymTable->buckets);
+   free(oSymTable->occupied);
+   if (oSymTable->oldBuckets != NULL)
+      free(oSymTable->oldBuckets);
+   free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getLength(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+
+   return oSymTable->numBindings;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the binding of the input oSymTable whose key is pcKey, whose 
+length is keyLength and whose hash code is hash, and sets *piInserted 
+to 0 (FALSE). If there is no such binding, adds one of pcKey to pvValue 
+that holds pcKey as eStorage says, returns it and sets *piInserted to 1 
+(TRUE). If insufficient memory is available, leaves oSymTable unchanged 
+and returns NULL. */
+
+static struct Binding *SymTable_findOrAdd(SymTable_T oSymTable, 
+   const char *pcKey, size_t keyLength, uint64_t hash, 
+   enum KeyStorage eStorage, const void *pvValue, int *piInserted) {
+   
+   struct Binding *psNewBinding;
+   size_t bucket;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(piInserted != NULL);
+
+   *piInserted = 0;
+
+   /* check if present already */
+   psNewBinding = SymTable_find(oSymTable, pcKey, keyLength, hash);
+   if (psNewBinding != NULL)
+      return psNewBinding;
+
+   /* atoms are never copied */
+   if (oSymTable->atomKeys)
+      eStorage = KEY_BORROW;
+
+  /* allocating new memory, with room for the key if it is copied, and 
+  rebinding */
+   psNewBinding = SymTable_allocBinding(oSymTable, 
+      eStorage == KEY_COPY ? keyLength : 0);
+   if (psNewBinding == NULL)
+         return NULL;
+   if (eStorage == KEY_COPY) {
+      memcpy(psNewBinding->key, pcKey, keyLength);
+      psNewBinding->key[keyLength] = '\0';
+      psNewBinding->pcKey = psNewBinding->key;
+   }
+   else {
+      psNewBinding->key[0] = '\0';
+      psNewBinding->pcKey = pcKey;
+   }
+   psNewBinding->keyLength = (uint32_t)(keyLength < UINT32_MAX ? 
+      keyLength : UINT32_MAX);
+   psNewBinding->ownsKey = (char)(eStorage == KEY_OWN);
+   if (eStorage == KEY_OWN)
+      oSymTable->numOwnedKeys++;
+
+   bucket = SymTable_bucket(hash, oSymTable->numBucketCounts);
+   psNewBinding->psNextBinding = oSymTable->buckets[bucket];
+   oSymTable->buckets[bucket] = psNewBinding;
+   SymTable_setOccupied(oSymTable, bucket);
+
+   psNewBinding->hash = hash;
+
+   psNewBinding->value = (void*)pvValue;
+
+   oSymTable->numBindings++;
+
+   /* grow once the average list length passes one binding; bindings 
+   are relinked, not moved, so psNewBinding stays where it is */
+   if (oSymTable->numBindings > oSymTable->numBucketCounts)
+      if (oSymTable->bucketIndex + 1 < numBucketSizes)
+         (void)SymTable_expand(oSymTable, oSymTable->bucketIndex + 1);
+
+   *piInserted = 1;
+   return psNewBinding;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Adds a binding of pcKey, whose length is keyLength and whose hash 
+code is hash, to pvValue to the input oSymTable, holding pcKey as 
+eStorage says, and returns 1 (TRUE), unless oSymTable already contains 
+a binding with key pcKey or insufficient memory is available, in which 
+case it leaves oSymTable unchanged and returns 0 (FALSE). */
+
+static int SymTable_insert(SymTable_T oSymTable, const char *pcKey, 
+   size_t keyLength, uint64_t hash, enum KeyStorage eStorage, 
+   const void *pvValue) {
+
+   int iInserted;
+
+   (void)SymTable_findOrAdd(oSymTable, pcKey, keyLength, hash, eStorage,
+      pvValue, &iInserted);
+   return iInserted;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_put(SymTable_T oSymTable,
+   const char *pcKey, const void *pvValue) {
+   
+   size_t keyLength;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   SymTable_migrate(oSymTable);
+
+   keyLength = SymTable_keyLength(oSymTable, pcKey);
+   return SymTable_insert(oSymTable, pcKey, keyLength, 
+      SymTable_hashKey(oSymTable, pcKey, keyLength), KEY_COPY, pvValue);
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_putBorrowed(SymTable_T oSymTable,
+   const char *pcKey, const void *pvValue) {
+   
+   size_t keyLength;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   SymTable_migrate(oSymTable);
+
+   keyLength = SymTable_keyLength(oSymTable, pcKey);
+   return SymTable_insert(oSymTable, pcKey, keyLength, 
+      SymTable_hashKey(oSymTable, pcKey, keyLength), KEY_BORROW, 
+      pvValue);
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_putOwned(SymTable_T oSymTable,
+   char *pcKey, const void *pvValue) {
+   
+   size_t keyLength;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(! oSymTable->atomKeys);
+
+   SymTable_migrate(oSymTable);
+
+   keyLength = SymTable_keyLength(oSymTable, pcKey);
+   return SymTable_insert(oSymTable, pcKey, keyLength, 
+      SymTable_hashKey(oSymTable, pcKey, keyLength), KEY_OWN, pvValue);
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_replace(SymTable_T oSymTable,
+   const char *pcKey, const void *pvValue) {
+   
+   void* temp;
+   struct Binding *psCurrentBinding;
+   size_t keyLength;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   SymTable_migrate(oSymTable);
+
+   /* find, and if found, replace */
+   keyLength = SymTable_keyLength(oSymTable, pcKey);
+   psCurrentBinding = SymTable_find(oSymTable, pcKey, keyLength, 
+      SymTable_hashKey(oSymTable, pcKey, keyLength));
+   if (psCurrentBinding == NULL)
+      return NULL;
+
+   temp = (void*)psCurrentBinding->value;
+   psCurrentBinding->value = pvValue;
+   return temp;
+}
+
+/*--------------------------------------------------------------------*/
+
+void **SymTable_findOrInsert(SymTable_T oSymTable, const char *pcKey,
+   const void *pvValue, int *piInserted) {
+
+   struct Binding *psBinding;
+   size_t keyLength;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   SymTable_migrate(oSymTable);
+
+   keyLength = SymTable_keyLength(oSymTable, pcKey);
+   psBinding = SymTable_findOrAdd(oSymTable, pcKey, keyLength, 
+      SymTable_hashKey(oSymTable, pcKey, keyLength), KEY_COPY, pvValue, 
+      &iInserted);
+   if (piInserted != NULL)
+      *piInserted = iInserted;
+   if (psBinding == NULL)
+      return NULL;
+
+   return (void**)&psBinding->value;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_upsert(SymTable_T oSymTable, const char *pcKey, 
+   const void *pvValue) {
+
+   void **ppvValue;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   /* one lookup either finds the binding or adds it */
+   ppvValue = SymTable_findOrInsert(oSymTable, pcKey, pvValue, 
+      &iInserted);
+   if (ppvValue == NULL)
+      return 0;
+
+   if (! iInserted)
+      *ppvValue = (void*)pvValue;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+const char *SymTable_intern(SymTable_T oSymTable, const char *pcKey) {
+   struct Binding *psBinding;
+   size_t keyLength;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(! oSymTable->atomKeys);
+
+   SymTable_migrate(oSymTable);
+
+   /* the binding's key is the atom; bindings never move */
+   keyLength = strlen(pcKey);
+   psBinding = SymTable_findOrAdd(oSymTable, pcKey, keyLength, 
+      SymTable_hashKey(oSymTable, pcKey, keyLength), KEY_COPY, NULL, 
+      &iInserted);
+   if (psBinding == NULL)
+      return NULL;
+
+   return psBinding->pcKey;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+
+   size_t keyLength;
+   
+   assert (oSymTable != NULL);
+   assert (pcKey != NULL);
+
+   SymTable_migrate(oSymTable);
+
+   keyLength = SymTable_keyLength(oSymTable, pcKey);
+   return SymTable_find(oSymTable, pcKey, keyLength, 
+      SymTable_hashKey(oSymTable, pcKey, keyLength)) != NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+
+   struct Binding *psCurrentBinding;
+   size_t keyLength;
+
+   assert (oSymTable != NULL);
+   assert (pcKey != NULL);
+
+   SymTable_migrate(oSymTable);
+
+   keyLength = SymTable_keyLength(oSymTable, pcKey);
+   psCurrentBinding = SymTable_find(oSymTable, pcKey, keyLength, 
+      SymTable_hashKey(oSymTable, pcKey, keyLength));
+   if (psCurrentBinding == NULL)
+      return NULL;
+
+   return (void*)psCurrentBinding->value;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* If the input oSymTable contains a binding with key pcKey, whose 
+length is keyLength and whose hash code is hash, removes it and returns 
+its value. Otherwise leaves oSymTable unchanged and returns NULL. */
+
+static void *SymTable_delete(SymTable_T oSymTable, const char *pcKey,
+   size_t keyLength, uint64_t hash) {
+
+   void* temp;
+   struct Binding *psCurrentBinding;
+   size_t bucket;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   /* checks if present, in the new buckets and then the old ones */
+   bucket = SymTable_bucket(hash, oSymTable->numBucketCounts);
+   psCurrentBinding = SymTable_unlink(oSymTable, 
+      &oSymTable->buckets[bucket], pcKey, keyLength, hash);
+   if (psCurrentBinding != NULL)
+      SymTable_setOccupied(oSymTable, bucket);
+   else if (oSymTable->oldBuckets != NULL)
+      psCurrentBinding = SymTable_unlink(oSymTable, 
+         &oSymTable->oldBuckets[SymTable_bucket(hash, 
+         oSymTable->numOldBucketCounts)], pcKey, keyLength, hash);
+   if (psCurrentBinding == NULL)
+      return NULL;
+
+   /* save old value, decrease count, return old value */
+   temp = (void*)psCurrentBinding->value;
+
+   if (psCurrentBinding->ownsKey) {
+      free((char*)psCurrentBinding->pcKey);
+      oSymTable->numOwnedKeys--;
+   }
+   SymTable_freeBinding(oSymTable, psCurrentBinding);
+
+   oSymTable->numBindings--;
+
+   return temp;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+
+   size_t keyLength;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   SymTable_migrate(oSymTable);
+
+   keyLength = SymTable_keyLength(oSymTable, pcKey);
+   return SymTable_delete(oSymTable, pcKey, keyLength, 
+      SymTable_hashKey(oSymTable, pcKey, keyLength));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Applies function *pfApply to each binding in the numBucketCounts 
+lists of the input buckets array, passing pvExtra as an extra 
+parameter. */
+
+static void SymTable_mapBuckets(struct Binding **buckets,
+   size_t numBucketCounts,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+   
+   struct Binding *psCurrentBinding;
+   size_t i;
+
+   const char *key;
+   void* value;
+
+   assert(buckets != NULL);
+   assert(pfApply != NULL);
+
+   for (i = 0; i < numBucketCounts; i++) {
+      psCurrentBinding = buckets[i];
+      while (psCurrentBinding != NULL) {
+         key = psCurrentBinding->pcKey;
+         value = (void*)psCurrentBinding->value;
+         /* apply the function on each binding */
+         (*pfApply)(key, value, (void*)pvExtra);
+         psCurrentBinding = psCurrentBinding->psNextBinding;
+      }
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_map(SymTable_T oSymTable,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+
+   assert(oSymTable != NULL);
+   assert(pfApply != NULL);
+
+   SymTable_mapBuckets(oSymTable->buckets, oSymTable->numBucketCounts,
+      pfApply, pvExtra);
+   if (oSymTable->oldBuckets != NULL)
+      SymTable_mapBuckets(oSymTable->oldBuckets, 
+         oSymTable->numOldBucketCounts, pfApply, pvExtra);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Claims chunks of the SymTable_mapParallel job pvJob, a struct 
+MapJob, and applies the job's function to the bindings of each, until 
+there are no chunks left. Returns NULL. Runs in every thread of the 
+job. */
+
+static void *SymTable_mapChunks(void *pvJob) {
+   struct MapJob *psJob;
+   struct Binding **buckets;
+   size_t numBucketCounts;
+   size_t chunk;
+   size_t start;
+
+   assert(pvJob != NULL);
+
+   psJob = (struct MapJob*)pvJob;
+   for (;;) {
+      pthread_mutex_lock(&psJob->mutex);
+      chunk = psJob->nextChunk++;
+      pthread_mutex_unlock(&psJob->mutex);
+      if (chunk >= psJob->numChunks)
+         return NULL;
+
+      if (chunk < psJob->numOldChunks) {
+         buckets = psJob->oSymTable->oldBuckets;
+         numBucketCounts = psJob->oSymTable->numOldBucketCounts;
+      }
+      else {
+         chunk -= psJob->numOldChunks;
+         buckets = psJob->oSymTable->buckets;
+         numBucketCounts = psJob->oSymTable->numBucketCounts;
+      }
+
+      start = chunk * MAP_CHUNK_BUCKETS;
+      SymTable_mapBuckets(buckets + start, 
+         numBucketCounts - start < MAP_CHUNK_BUCKETS ? 
+         numBucketCounts - start : MAP_CHUNK_BUCKETS, 
+         psJob->pfApply, psJob->pvExtra);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_mapParallel(SymTable_T oSymTable,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra, size_t nThreads) {
+
+   struct MapJob sJob;
+   pthread_t *aThreads;
+   size_t numStarted;
+
+   assert(oSymTable != NULL);
+   assert(pfApply != NULL);
+
+   sJob.oSymTable = oSymTable;
+   sJob.pfApply = pfApply;
+   sJob.pvExtra = pvExtra;
+   sJob.nextChunk = 0;
+   sJob.numOldChunks = (oSymTable->numOldBucketCounts + 
+      MAP_CHUNK_BUCKETS - 1) / MAP_CHUNK_BUCKETS;
+   sJob.numChunks = sJob.numOldChunks + (oSymTable->numBucketCounts + 
+      MAP_CHUNK_BUCKETS - 1) / MAP_CHUNK_BUCKETS;
+
+   /* no more threads than chunks; one thread needs no locking */
+   if (nThreads > sJob.numChunks)
+      nThreads = sJob.numChunks;
+   if (nThreads <= 1) {
+      SymTable_map(oSymTable, pfApply, pvExtra);
+      return;
+   }
+
+   aThreads = (pthread_t*)malloc((nThreads - 1) * sizeof(pthread_t));
+   if (aThreads == NULL || 
+      pthread_mutex_init(&sJob.mutex, NULL) != 0) {
+      free(aThreads);
+      SymTable_map(oSymTable, pfApply, pvExtra);
+      return;
+   }
+
+   /* the calling thread is one of the workers; if a thread cannot be 
+   started, the others take on its share */
+   for (numStarted = 0; numStarted < nThreads - 1; numStarted++)
+      if (pthread_create(&aThreads[numStarted], NULL, 
+         SymTable_mapChunks, &sJob) != 0)
+         break;
+   (void)SymTable_mapChunks(&sJob);
+
+   while (numStarted > 0)
+      pthread_join(aThreads[--numStarted], NULL);
+   pthread_mutex_destroy(&sJob.mutex);
+   free(aThreads);
+}
+
+/*--------------------------------------------------------------------*/
+
+struct SymTableHashedKey SymTable_prehash(SymTable_T oSymTable, 
+   const char *pcKey) {
+
+   struct SymTableHashedKey sKey;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   sKey.pcKey = pcKey;
+   sKey.keyLength = SymTable_keyLength(oSymTable, pcKey);
+   sKey.hash = SymTable_hashKey(oSymTable, pcKey, sKey.keyLength);
+   sKey.seed = oSymTable->seed;
+   return sKey;
+}
+
+/*--------------------------------------------------------------------*/
+
+struct SymTableHashedKey SymTable_prehashN(SymTable_T oSymTable, 
+   const char *pcKey, size_t keyLength) {
+
+   struct SymTableHashedKey sKey;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   /* the caller's functions and atoms need whole strings */
+   assert(oSymTable->pfHash == NULL && oSymTable->pfEqual == NULL);
+   assert(! oSymTable->atomKeys);
+
+   sKey.pcKey = pcKey;
+   sKey.keyLength = keyLength;
+   sKey.hash = SymTable_hash(oSymTable, pcKey, keyLength);
+   sKey.seed = oSymTable->seed;
+   return sKey;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_putHashed(SymTable_T oSymTable, 
+   struct SymTableHashedKey sKey, const void *pvValue) {
+
+   assert(oSymTable != NULL);
+   assert(sKey.pcKey != NULL);
+   /* sKey.hash is only valid with the seed it was made with */
+   assert(sKey.seed == oSymTable->seed);
+
+   SymTable_migrate(oSymTable);
+
+   return SymTable_insert(oSymTable, sKey.pcKey, sKey.keyLength, 
+      sKey.hash, KEY_COPY, pvValue);
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_replaceHashed(SymTable_T oSymTable,
+   struct SymTableHashedKey sKey, const void *pvValue) {
+
+   void* temp;
+   struct Binding *psCurrentBinding;
+
+   assert(oSymTable != NULL);
+   assert(sKey.pcKey != NULL);
+   /* sKey.hash is only valid with the seed it was made with */
+   assert(sKey.seed == oSymTable->seed);
+
+   SymTable_migrate(oSymTable);
+
+   psCurrentBinding = SymTable_find(oSymTable, sKey.pcKey, 
+      sKey.keyLength, sKey.hash);
+   if (psCurrentBinding == NULL)
+      return NULL;
+
+   temp = (void*)psCurrentBinding->value;
+   psCurrentBinding->value = pvValue;
+   return temp;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_containsHashed(SymTable_T oSymTable, 
+   struct SymTableHashedKey sKey) {
+
+   assert(oSymTable != NULL);
+   assert(sKey.pcKey != NULL);
+   /* sKey.hash is only valid with the seed it was made with */
+   assert(sKey.seed == oSymTable->seed);
+
+   SymTable_migrate(oSymTable);
+
+   return SymTable_find(oSymTable, sKey.pcKey, sKey.keyLength, 
+      sKey.hash) != NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_getHashed(SymTable_T oSymTable, 
+   struct SymTableHashedKey sKey) {
+
+   struct Binding *psCurrentBinding;
+
+   assert(oSymTable != NULL);
+   assert(sKey.pcKey != NULL);
+   /* sKey.hash is only valid with the seed it was made with */
+   assert(sKey.seed == oSymTable->seed);
+
+   SymTable_migrate(oSymTable);
+
+   psCurrentBinding = SymTable_find(oSymTable, sKey.pcKey, 
+      sKey.keyLength, sKey.hash);
+   if (psCurrentBinding == NULL)
+      return NULL;
+
+   return (void*)psCurrentBinding->value;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_removeHashed(SymTable_T oSymTable, 
+   struct SymTableHashedKey sKey) {
+
+   assert(oSymTable != NULL);
+   assert(sKey.pcKey != NULL);
+   /* sKey.hash is only valid with the seed it was made with */
+   assert(sKey.seed == oSymTable->seed);
+
+   SymTable_migrate(oSymTable);
+
+   return SymTable_delete(oSymTable, sKey.pcKey, sKey.keyLength, 
+      sKey.hash);
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_putN(SymTable_T oSymTable, const char *pcKey, 
+   size_t keyLength, const void *pvValue) {
+
+   return SymTable_putHashed(oSymTable, 
+      SymTable_prehashN(oSymTable, pcKey, keyLength), pvValue);
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_replaceN(SymTable_T oSymTable, const char *pcKey, 
+   size_t keyLength, const void *pvValue) {
+
+   return SymTable_replaceHashed(oSymTable, 
+      SymTable_prehashN(oSymTable, pcKey, keyLength), pvValue);
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_containsN(SymTable_T oSymTable, const char *pcKey, 
+   size_t keyLength) {
+
+   return SymTable_containsHashed(oSymTable, 
+      SymTable_prehashN(oSymTable, pcKey, keyLength));
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_getN(SymTable_T oSymTable, const char *pcKey, 
+   size_t keyLength) {
+
+   return SymTable_getHashed(oSymTable, 
+      SymTable_prehashN(oSymTable, pcKey, keyLength));
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_removeN(SymTable_T oSymTable, const char *pcKey, 
+   size_t keyLength) {
+
+   return SymTable_removeHashed(oSymTable, 
+      SymTable_prehashN(oSymTable, pcKey, keyLength));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Looks up the n keys of ppcKeys, where n is at most 
+GET_MANY_GROUP_SIZE, in the input oSymTable, storing the value of each 
+in ppvValues. Returns the number of keys found. All lookups advance in 
+step: each pass prefetches the next binding of every unfinished chain 
+before any of them is read, so their cache misses overlap. */
+
+static size_t SymTable_getGroup(SymTable_T oSymTable, 
+   const char *const *ppcKeys, size_t n, void **ppvValues) {
+
+   struct Binding **apsBucket[GET_MANY_GROUP_SIZE];
+   struct Binding *apsBinding[GET_MANY_GROUP_SIZE];
+   size_t auKeyLength[GET_MANY_GROUP_SIZE];
+   uint64_t auHash[GET_MANY_GROUP_SIZE];
+   int aiFound[GET_MANY_GROUP_SIZE];
+   struct Binding *psBinding;
+   size_t numActive;
+   size_t numFound = 0;
+   size_t i;
+
+   assert(oSymTable != NULL);
+   assert(n <= GET_MANY_GROUP_SIZE);
+
+   /* hash every key and prefetch its bucket */
+   for (i = 0; i < n; i++) {
+      assert(ppcKeys[i] != NULL);
+      auKeyLength[i] = SymTable_keyLength(oSymTable, ppcKeys[i]);
+      auHash[i] = SymTable_hashKey(oSymTable, ppcKeys[i], 
+         auKeyLength[i]);
+      apsBucket[i] = &oSymTable->buckets[SymTable_bucket(auHash[i], 
+         oSymTable->numBucketCounts)];
+      PREFETCH(apsBucket[i]);
+   }
+
+   /* read every bucket and prefetch its first binding */
+   for (i = 0; i < n; i++) {
+      apsBinding[i] = *apsBucket[i];
+      aiFound[i] = 0;
+      PREFETCH(apsBinding[i]);
+   }
+
+   /* step every unfinished chain by one binding per pass */
+   do {
+      numActive = 0;
+      for (i = 0; i < n; i++) {
+         psBinding = apsBinding[i];
+         if (psBinding == NULL)
+            continue;
+         if (psBinding->hash == auHash[i] && 
+            SymTable_equal(oSymTable, psBinding, ppcKeys[i], 
+               auKeyLength[i])) {
+            ppvValues[i] = (void*)psBinding->value;
+            aiFound[i] = 1;
+            numFound++;
+            apsBinding[i] = NULL;
+            continue;
+         }
+         apsBinding[i] = psBinding->psNextBinding;
+         PREFETCH(apsBinding[i]);
+         numActive++;
+      }
+   } while (numActive > 0);
+
+   /* keys not found yet may be waiting in oldBuckets */
+   if (oSymTable->oldBuckets != NULL) {
+      for (i = 0; i < n; i++) {
+         if (aiFound[i])
+            continue;
+         psBinding = SymTable_find(oSymTable, ppcKeys[i], 
+            auKeyLength[i], auHash[i]);
+         if (psBinding != NULL) {
+            ppvValues[i] = (void*)psBinding->value;
+            numFound++;
+         }
+      }
+   }
+
+   return numFound;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getMany(SymTable_T oSymTable, 
+   const char *const *ppcKeys, size_t n, void **ppvValues) {
+
+   size_t numFound = 0;
+   size_t i;
+
+   assert(oSymTable != NULL);
+   assert(ppcKeys != NULL || n == 0);
+   assert(ppvValues != NULL || n == 0);
+
+   SymTable_migrate(oSymTable);
+
+   for (i = 0; i < n; i++)
+      ppvValues[i] = NULL;
+
+   for (i = 0; i < n; i += GET_MANY_GROUP_SIZE)
+      numFound += SymTable_getGroup(oSymTable, ppcKeys + i, 
+         n - i < GET_MANY_GROUP_SIZE ? n - i : GET_MANY_GROUP_SIZE,
+         ppvValues + i);
+
+   return numFound;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_putMany(SymTable_T oSymTable, 
+   const char *const *ppcKeys, const void *const *ppvValues, size_t n,
+   int *piResults) {
+
+   size_t auKeyLength[GET_MANY_GROUP_SIZE];
+   uint64_t auHash[GET_MANY_GROUP_SIZE];
+   size_t *puKeyLengths = NULL;
+   size_t numPut = 0;
+   size_t numBytes = 0;
+   size_t sizeClass;
+   size_t groupSize;
+   size_t i;
+   size_t j;
+   int iSuccessful;
+
+   assert(oSymTable != NULL);
+   assert(ppcKeys != NULL || n == 0);
+   assert(ppvValues != NULL || n == 0);
+
+   /* size the bucket array once for the final count */
+   (void)SymTable_reserve(oSymTable, oSymTable->numBindings + n);
+
+   /* carve all the new bindings out of one slab, keeping the key 
+   lengths that size it for the insertions; if that much memory is not 
+   available, let the bindings come from ordinary slabs */
+   if (n > 0 && n <= SIZE_MAX / sizeof(size_t))
+      puKeyLengths = (size_t*)malloc(n * sizeof(size_t));
+   if (puKeyLengths != NULL) {
+      for (i = 0; i < n; i++) {
+         assert(ppcKeys[i] != NULL);
+         puKeyLengths[i] = SymTable_keyLength(oSymTable, ppcKeys[i]);
+         sizeClass = SymTable_sizeClass(puKeyLengths[i]);
+         if (sizeClass < NUM_SIZE_CLASSES)
+            numBytes += (sizeClass + 1) * ALLOC_GRAIN;
+      }
+
+      /* the first new bindings take what is left of the newest slab, 
+      by way of the free lists, so only the rest needs a new one */
+      for (i = 0; i < n && numBytes > oSymTable->slabBytesLeft; i++) {
+         sizeClass = SymTable_sizeClass(puKeyLengths[i]);
+         if (sizeClass >= NUM_SIZE_CLASSES)
+            continue;
+         if ((sizeClass + 1) * ALLOC_GRAIN > oSymTable->slabBytesLeft)
+            break;
+         SymTable_carveFree(oSymTable, sizeClass);
+         numBytes -= (sizeClass + 1) * ALLOC_GRAIN;
+      }
+      (void)SymTable_reserveSlab(oSymTable, numBytes);
+   }
+
+   for (i = 0; i < n; i += groupSize) {
+      groupSize = n - i < GET_MANY_GROUP_SIZE ? n - i : 
+         GET_MANY_GROUP_SIZE;
+
+      /* hash a group of keys and prefetch their buckets, so the cache 
+      misses of the group overlap */
+      for (j = 0; j < groupSize; j++) {
+         if (puKeyLengths != NULL)
+            auKeyLength[j] = puKeyLengths[i + j];
+         else
+            auKeyLength[j] = SymTable_keyLength(oSymTable, 
+               ppcKeys[i + j]);
+         auHash[j] = SymTable_hashKey(oSymTable, ppcKeys[i + j], 
+            auKeyLength[j]);
+         PREFETCH(&oSymTable->buckets[SymTable_bucket(auHash[j], 
+            oSymTable->numBucketCounts)]);
+      }
+
+      /* one lookup per key finds duplicates, in the table or earlier 
+      in the batch */
+      for (j = 0; j < groupSize; j++) {
+         SymTable_migrate(oSymTable);
+         iSuccessful = SymTable_insert(oSymTable, ppcKeys[i + j], 
+            auKeyLength[j], auHash[j], KEY_COPY, ppvValues[i + j]);
+         if (iSuccessful)
+            numPut++;
+         if (piResults != NULL)
+            piResults[i + j] = iSuccessful;
+      }
+   }
+
+   free(puKeyLengths);
+   return numPut;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Writes the bindings in the numBucketCounts lists of the input
+buckets array to psFile, each as a record of its hash code, key length
+and value size followed by its key and the bytes of its value. Values
+are stored by *pfSaveValue in *ppvBuffer, which holds *puBufferSize
+bytes and is replaced by a bigger buffer as needed. Returns 1 (TRUE) on
+success, or 0 (FALSE) if a write fails or insufficient memory is
+available. */
+
+static int SymTable_saveBuckets(struct Binding **buckets,
+   size_t numBucketCounts, FILE *psFile,
+   size_t (*pfSaveValue)(const void *pvValue, void *pvBuffer,
+   size_t uSize), void **ppvBuffer, size_t *puBufferSize) {
+
+   struct Binding *psCurrentBinding;
+   uint64_t auRecord[SNAPSHOT_RECORD_WORDS];
+   size_t keyLength;
+   size_t valueSize;
+   size_t i;
+
+   assert(buckets != NULL);
+   assert(psFile != NULL);
+   assert(pfSaveValue != NULL);
+   assert(ppvBuffer != NULL);
+   assert(puBufferSize != NULL);
+
+   for (i = 0; i < numBucketCounts; i++)
+      for (psCurrentBinding = buckets[i]; psCurrentBinding != NULL;
+         psCurrentBinding = psCurrentBinding->psNextBinding) {
+         keyLength = psCurrentBinding->keyLength < UINT32_MAX ?
+            psCurrentBinding->keyLength :
+            strlen(psCurrentBinding->pcKey);
+
+         /* grow the buffer once for a value that does not fit */
+         valueSize = (*pfSaveValue)(psCurrentBinding->value,
+            *ppvBuffer, *puBufferSize);
+         if (valueSize > *puBufferSize) {
+            free(*ppvBuffer);
+            *ppvBuffer = malloc(valueSize);
+            if (*ppvBuffer == NULL) {
+               *puBufferSize = 0;
+               return 0;
+            }
+            *puBufferSize = valueSize;
+            if ((*pfSaveValue)(psCurrentBinding->value, *ppvBuffer,
+               *puBufferSize) != valueSize)
+               return 0;
+         }
+
+         auRecord[0] = psCurrentBinding->hash;
+         auRecord[1] = keyLength;
+         auRecord[2] = valueSize;
+         if (fwrite(auRecord, sizeof(auRecord), 1, psFile) != 1 ||
+            fwrite(psCurrentBinding->pcKey, 1, keyLength, psFile) !=
+            keyLength ||
+            fwrite(*ppvBuffer, 1, valueSize, psFile) != valueSize)
+            return 0;
+      }
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_save(SymTable_T oSymTable, const char *pcPath,
+   size_t (*pfSaveValue)(const void *pvValue, void *pvBuffer,
+   size_t uSize)) {
+
+   FILE *psFile;
+   uint64_t auHeader[SNAPSHOT_HEADER_WORDS];
+   void *pvBuffer;
+   size_t bufferSize = SNAPSHOT_VALUE_SIZE;
+   int iSuccessful;
+
+   assert(oSymTable != NULL);
+   assert(pcPath != NULL);
+   assert(pfSaveValue != NULL);
+   /* the stored hash codes are only valid for the built-in hash */
+   assert(oSymTable->pfHash == NULL && oSymTable->pfEqual == NULL);
+   assert(! oSymTable->atomKeys);
+
+   pvBuffer = malloc(bufferSize);
+   if (pvBuffer == NULL)
+      return 0;
+   psFile = fopen(pcPath, "wb");
+   if (psFile == NULL) {
+      free(pvBuffer);
+      return 0;
+   }
+   (void)setvbuf(psFile, NULL, _IOFBF, SNAPSHOT_BUFFER_SIZE);
+
+   auHeader[0] = SNAPSHOT_MAGIC;
+   auHeader[1] = oSymTable->seed;
+   auHeader[2] = oSymTable->numBindings;
+   iSuccessful = fwrite(auHeader, sizeof(auHeader), 1, psFile) == 1 &&
+      SymTable_saveBuckets(oSymTable->buckets,
+         oSymTable->numBucketCounts, psFile, pfSaveValue, &pvBuffer,
+         &bufferSize) &&
+      (oSymTable->oldBuckets == NULL ||
+      SymTable_saveBuckets(oSymTable->oldBuckets,
+         oSymTable->numOldBucketCounts, psFile, pfSaveValue, &pvBuffer,
+         &bufferSize));
+
+   if (fclose(psFile) != 0)
+      iSuccessful = 0;
+   free(pvBuffer);
+   return iSuccessful;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Reads the next binding of the snapshot psFile into the input
+oSymTable, making its value with *pfLoadValue from the bytes read into
+*ppvBuffer, which holds *puBufferSize bytes and is replaced by a bigger
+buffer as needed. The binding is linked in by its stored hash code,
+without a search for its key. *puBytesLeft is the number of bytes of
+the file not yet read; the record's sizes are checked against it
+before anything is allocated for them, and it is reduced by the size
+of the binding. Returns 1 (TRUE) on success, or 0 (FALSE) if the file
+ends or is corrupt, *pfLoadValue fails or insufficient memory is
+available. */
+
+static int SymTable_loadBinding(SymTable_T oSymTable, FILE *psFile,
+   int (*pfLoadValue)(const void *pvBytes, size_t uSize,
+   void **ppvValue), void **ppvBuffer, size_t *puBufferSize,
+   uint64_t *puBytesLeft) {
+
+   struct Binding *psNewBinding;
+   uint64_t auRecord[SNAPSHOT_RECORD_WORDS];
+   void *pvValue;
+   size_t keyLength;
+   size_t valueSize;
+   size_t bucket;
+
+   assert(oSymTable != NULL);
+   assert(psFile != NULL);
+   assert(pfLoadValue != NULL);
+   assert(ppvBuffer != NULL);
+   assert(puBufferSize != NULL);
+   assert(puBytesLeft != NULL);
+
+   if (*puBytesLeft < sizeof(auRecord) ||
+      fread(auRecord, sizeof(auRecord), 1, psFile) != 1)
+      return 0;
+   *puBytesLeft -= sizeof(auRecord);
+   if (auRecord[1] > *puBytesLeft ||
+      auRecord[2] > *puBytesLeft - auRecord[1])
+      return 0;
+   *puBytesLeft -= auRecord[1] + auRecord[2];
+   keyLength = (size_t)auRecord[1];
+   valueSize = (size_t)auRecord[2];
+   if (keyLength != auRecord[1] || valueSize != auRecord[2] ||
+      keyLength > SIZE_MAX / 2)
+      return 0;
+
+   /* the key is read straight into its binding */
+   psNewBinding = SymTable_allocBinding(oSymTable, keyLength);
+   if (psNewBinding == NULL)
+      return 0;
+   if (fread(psNewBinding->key, 1, keyLength, psFile) != keyLength)
+      return 0;
+   psNewBinding->key[keyLength] = '\0';
+
+   if (valueSize > *puBufferSize) {
+      free(*ppvBuffer);
+      *ppvBuffer = malloc(valueSize);
+      if (*ppvBuffer == NULL) {
+         *puBufferSize = 0;
+         return 0;
+      }
+      *puBufferSize = valueSize;
+   }
+   if (fread(*ppvBuffer, 1, valueSize, psFile) != valueSize ||
+      ! (*pfLoadValue)(*ppvBuffer, valueSize, &pvValue))
+      return 0;
+
+   psNewBinding->pcKey = psNewBinding->key;
+   psNewBinding->keyLength = (uint32_t)(keyLength < UINT32_MAX ?
+      keyLength : UINT32_MAX);
+   psNewBinding->ownsKey = 0;
+   psNewBinding->hash = auRecord[0];
+   psNewBinding->value = pvValue;
+
+   bucket = SymTable_bucket(psNewBinding->hash,
+      oSymTable->numBucketCounts);
+   psNewBinding->psNextBinding = oSymTable->buckets[bucket];
+   oSymTable->buckets[bucket] = psNewBinding;
+   SymTable_setOccupied(oSymTable, bucket);
+   oSymTable->numBindings++;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Passes the value of each binding in the numBucketCounts lists of
+the input buckets array to *pfFreeValue. */
+
+static void SymTable_freeValues(struct Binding **buckets,
+   size_t numBucketCounts, void (*pfFreeValue)(void *pvValue)) {
+
+   struct Binding *psCurrentBinding;
+   size_t i;
+
+   assert(buckets != NULL);
+   assert(pfFreeValue != NULL);
+
+   for (i = 0; i < numBucketCounts; i++)
+      for (psCurrentBinding = buckets[i]; psCurrentBinding != NULL;
+         psCurrentBinding = psCurrentBinding->psNextBinding)
+         (*pfFreeValue)((void*)psCurrentBinding->value);
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_load(const char *pcPath,
+   int (*pfLoadValue)(const void *pvBytes, size_t uSize,
+   void **ppvValue), void (*pfFreeValue)(void *pvValue)) {
+
+   SymTable_T oSymTable = NULL;
+   FILE *psFile;
+   uint64_t auHeader[SNAPSHOT_HEADER_WORDS];
+   uint64_t bytesLeft;
+   void *pvBuffer;
+   size_t bufferSize = SNAPSHOT_VALUE_SIZE;
+   size_t numBindings;
+   size_t i;
+   long fileSize;
+
+   assert(pcPath != NULL);
+   assert(pfLoadValue != NULL);
+
+   psFile = fopen(pcPath, "rb");
+   if (psFile == NULL)
+      return NULL;
+   (void)setvbuf(psFile, NULL, _IOFBF, SNAPSHOT_BUFFER_SIZE);
+
+   /* the file's length bounds every count and size in it */
+   if (fseek(psFile, 0L, SEEK_END) != 0 ||
+      (fileSize = ftell(psFile)) < 0 ||
+      fseek(psFile, 0L, SEEK_SET) != 0) {
+      (void)fclose(psFile);
+      return NULL;
+   }
+   bytesLeft = (uint64_t)fileSize;
+
+   pvBuffer = malloc(bufferSize);
+   if (pvBuffer != NULL && bytesLeft >= sizeof(auHeader) &&
+      fread(auHeader, sizeof(auHeader), 1, psFile) == 1 &&
+      auHeader[0] == SNAPSHOT_MAGIC &&
+      (size_t)auHeader[2] == auHeader[2] &&
+      auHeader[2] <= (bytesLeft - sizeof(auHeader)) /
+         (SNAPSHOT_RECORD_WORDS * sizeof(uint64_t))) {
+
+      /* size the bucket array once for the final count, and keep the
+      snapshot's seed so that its hash codes stay valid */
+      bytesLeft -= sizeof(auHeader);
+      numBindings = (size_t)auHeader[2];
+      oSymTable = SymTable_create(NULL, NULL,
+         SymTable_indexFor(numBindings));
+      if (oSymTable != NULL) {
+         SymTable_setSeed(oSymTable, auHeader[1]);
+         for (i = 0; i < numBindings; i++)
+            if (! SymTable_loadBinding(oSymTable, psFile, pfLoadValue,
+               &pvBuffer, &bufferSize, &bytesLeft))
+               break;
+
+         /* give back the values made before a failure */
+         if (i < numBindings) {
+            if (pfFreeValue != NULL)
+               SymTable_freeValues(oSymTable->buckets,
+                  oSymTable->numBucketCounts, pfFreeValue);
+            SymTable_free(oSymTable);
+            oSymTable = NULL;
+         }
+      }
+   }
+
+   (void)fclose(psFile);
+   free(pvBuffer);
+   return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_iterBegin(SymTable_T oSymTable, 
+   struct SymTableIter *psIter) {
+
+   assert(oSymTable != NULL);
+   assert(psIter != NULL);
+
+   /* with a single bucket array, lookups during the enumeration cannot
+   move bindings */
+   while (oSymTable->oldBuckets != NULL)
+      SymTable_migrate(oSymTable);
+
+   psIter->oSymTable = oSymTable;
+   psIter->bucket = 0;
+   psIter->pvBinding = NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_iterNext(struct SymTableIter *psIter, const char **ppcKey,
+   void **ppvValue) {
+
+   SymTable_T oSymTable;
+   struct Binding *psBinding;
+   size_t numWords;
+   size_t word;
+   size_t bits;
+
+   assert(psIter != NULL);
+   assert(psIter->oSymTable != NULL);
+
+   oSymTable = psIter->oSymTable;
+   psBinding = (struct Binding*)psIter->pvBinding;
+
+   /* when the current list is done, use the bitmap to find the next 
+   bucket that is not empty */
+   if (psBinding == NULL) {
+      if (psIter->bucket >= oSymTable->numBucketCounts)
+         return 0;
+
+      numWords = (oSymTable->numBucketCounts + OCCUPIED_BITS - 1) / 
+         OCCUPIED_BITS;
+      word = psIter->bucket / OCCUPIED_BITS;
+      bits = oSymTable->occupied[word] & 
+         (~(size_t)0 << (psIter->bucket % OCCUPIED_BITS));
+      while (bits == 0) {
+         if (++word == numWords) {
+            psIter->bucket = oSymTable->numBucketCounts;
+            return 0;
+         }
+         bits = oSymTable->occupied[word];
+      }
+
+      psIter->bucket = word * OCCUPIED_BITS + SymTable_lowestBit(bits);
+      psBinding = oSymTable->buckets[psIter->bucket];
+      psIter->bucket++;
+      assert(psBinding != NULL);
+   }
+
+   /* step past the binding first, so the caller may remove it */
+   psIter->pvBinding = psBinding->psNextBinding;
+
+   if (ppcKey != NULL)
+      *ppcKey = psBinding->pcKey;
+   if (ppvValue != NULL)
+      *ppvValue = (void*)psBinding->value;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,312 @@
+/*--------------------------------------------------------------------*/
+/* symtablehash.h                                                     */
+/* Author: Angel Chang Liu                                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLEHASH_included
+#define SYMTABLEHASH_included
+#include "symtable.h"
+#include <stdint.h>
+
+/* Extensions to the SymTable interface that only the hash table
+implementation (symtablehash.c) provides */
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a new SymTable object that contains no bindings, or NULL if
+insufficient memory is available. The table hashes keys with *pfHash
+and compares them with *pfEqual, which returns nonzero (TRUE) iff its
+two keys are equal. Keys that *pfEqual finds equal must have equal
+hash codes. The table mixes its own random seed into each hash code,
+so *pfHash need not spread its results. If pfHash or pfEqual is NULL,
+the table uses its built-in hash function or strcmp respectively,
+exactly as SymTable_new does. */
+
+SymTable_T SymTable_newWithOps(size_t (*pfHash)(const char *pcKey),
+   int (*pfEqual)(const char *pcKey1, const char *pcKey2));
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a new SymTable object that contains no bindings and is sized
+to hold uCapacity bindings without growing, or NULL if insufficient
+memory is available. A small uCapacity gives a table smaller than
+SymTable_new's. */
+
+SymTable_T SymTable_newWithCapacity(size_t uCapacity);
+
+/*--------------------------------------------------------------------*/
+
+/* Grows oSymTable, if needed, so that it holds uCapacity bindings in
+all without growing again. Bindings already in the table are moved
+over gradually by later calls, as when the table grows by itself.
+Returns 1 (TRUE) on success, or 0 (FALSE) and leaves oSymTable
+unchanged if insufficient memory is available. Inputs are SymTable_T
+oSymTable and size_t uCapacity */
+
+int SymTable_reserve(SymTable_T oSymTable, size_t uCapacity);
+
+/*--------------------------------------------------------------------*/
+
+/* The same as SymTable_put, except that the new binding refers to 
+pcKey itself instead of a copy. The caller must keep pcKey valid and 
+unchanged while the binding is in oSymTable. This suits keys that 
+already live in a long-lived buffer, such as a string pool or a mapped 
+file. */
+
+int SymTable_putBorrowed(SymTable_T oSymTable,
+   const char *pcKey, const void *pvValue);
+
+/*--------------------------------------------------------------------*/
+
+/* The same as SymTable_put, except that pcKey must have been allocated 
+by malloc, and that on success the new binding takes pcKey itself 
+instead of a copy. oSymTable then owns pcKey and frees it when the 
+binding is removed or oSymTable is freed. If SymTable_putOwned returns 
+0 (FALSE), pcKey still belongs to the caller. oSymTable must not be a 
+table made by SymTable_newForAtoms. */
+
+int SymTable_putOwned(SymTable_T oSymTable,
+   char *pcKey, const void *pvValue);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the atom for pcKey in oSymTable, which serves as an
+interner: the key of oSymTable's binding with key pcKey, first adding
+a binding of pcKey to NULL if there is none. Equal keys thus give the
+same atom, so atoms can be compared by address. An atom stays valid
+until its binding is removed or oSymTable is freed. Returns NULL if
+insufficient memory is available. oSymTable must not be a table made
+by SymTable_newForAtoms. Inputs are SymTable_T oSymTable and const
+char *pcKey */
+
+const char *SymTable_intern(SymTable_T oSymTable, const char *pcKey);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a new SymTable object that contains no bindings and whose
+keys are atoms from SymTable_intern, or NULL if insufficient memory is
+available. Such a table hashes and compares keys by address, without
+reading their characters, and refers to them instead of copying them,
+so the atoms must stay valid while they are keys of the table. All of
+the table's keys must come from the same interner. */
+
+SymTable_T SymTable_newForAtoms(void);
+
+/*--------------------------------------------------------------------*/
+
+/* A key together with its hash code in one particular SymTable, as 
+made by SymTable_prehash. The fields are private to the 
+implementation. */
+
+struct SymTableHashedKey {
+   /* The key itself, owned by the caller */
+   const char *pcKey;
+   /* The number of characters of pcKey */
+   size_t keyLength;
+   /* The hash code of pcKey in the table it was made for */
+   uint64_t hash;
+   /* The seed of that table, which the *Hashed functions check */
+   uint64_t seed;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a hashed key for pcKey in oSymTable, for use with the
+*Hashed functions below, which then skip hashing pcKey. The hashed key
+refers to pcKey, which must stay unchanged while the hashed key is in
+use. It stays valid as oSymTable grows, but must not be used with any
+other SymTable, which hashes keys differently, except one loaded from
+a snapshot of oSymTable, which hashes them the same way. The *Hashed
+functions check this with an assert. Inputs are SymTable_T oSymTable
+and const char *pcKey */
+
+struct SymTableHashedKey SymTable_prehash(SymTable_T oSymTable,
+   const char *pcKey);
+
+/*--------------------------------------------------------------------*/
+
+/* The same as SymTable_prehash, except that the key is the keyLength 
+characters at pcKey, which need not be followed by '\0' but must not 
+include it. oSymTable must use the built-in hash function and key 
+comparison, and must not be a table made by SymTable_newForAtoms. 
+Inputs are SymTable_T oSymTable, const char *pcKey and size_t 
+keyLength */
+
+struct SymTableHashedKey SymTable_prehashN(SymTable_T oSymTable,
+   const char *pcKey, size_t keyLength);
+
+/*--------------------------------------------------------------------*/
+
+/* The same as SymTable_put, SymTable_replace, SymTable_contains,
+SymTable_get and SymTable_remove respectively, except that the key is
+given by sKey, which must have been made by SymTable_prehash for
+oSymTable, or for a table of which oSymTable is a loaded snapshot. */
+
+int SymTable_putHashed(SymTable_T oSymTable,
+   struct SymTableHashedKey sKey, const void *pvValue);
+
+void *SymTable_replaceHashed(SymTable_T oSymTable,
+   struct SymTableHashedKey sKey, const void *pvValue);
+
+int SymTable_containsHashed(SymTable_T oSymTable,
+   struct SymTableHashedKey sKey);
+
+void *SymTable_getHashed(SymTable_T oSymTable,
+   struct SymTableHashedKey sKey);
+
+void *SymTable_removeHashed(SymTable_T oSymTable,
+   struct SymTableHashedKey sKey);
+
+/*--------------------------------------------------------------------*/
+
+/* The same as SymTable_put, SymTable_replace, SymTable_contains,
+SymTable_get and SymTable_remove respectively, except that the key is
+the keyLength characters at pcKey, as for SymTable_prehashN. Keys can 
+thus be looked up straight from a larger buffer, such as a tokenizer's 
+input, without being copied to add a '\0'. SymTable_putN stores a copy 
+of the key with a '\0' added, as SymTable_map hands it out. */
+
+int SymTable_putN(SymTable_T oSymTable, const char *pcKey,
+   size_t keyLength, const void *pvValue);
+
+void *SymTable_replaceN(SymTable_T oSymTable, const char *pcKey,
+   size_t keyLength, const void *pvValue);
+
+int SymTable_containsN(SymTable_T oSymTable, const char *pcKey,
+   size_t keyLength);
+
+void *SymTable_getN(SymTable_T oSymTable, const char *pcKey,
+   size_t keyLength);
+
+void *SymTable_removeN(SymTable_T oSymTable, const char *pcKey,
+   size_t keyLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Looks up each of the n keys of ppcKeys in oSymTable, and stores the
+value of its binding, or NULL if there is no such binding, in the
+matching element of ppvValues. Returns the number of keys found. The
+lookups of a batch are interleaved so their cache misses overlap, which
+makes this faster than n calls of SymTable_get. Inputs are SymTable_T
+oSymTable, const char *const *ppcKeys, size_t n and void **ppvValues */
+
+size_t SymTable_getMany(SymTable_T oSymTable,
+   const char *const *ppcKeys, size_t n, void **ppvValues);
+
+/*--------------------------------------------------------------------*/
+
+/* Puts each of the n keys of ppcKeys into oSymTable, bound to the
+matching element of ppvValues, exactly as n calls of SymTable_put
+would, and returns the number of bindings added. If piResults is not
+NULL, the matching element of piResults is set to the value that
+SymTable_put would have returned for each key. The bucket array is
+sized once for the whole batch and the new bindings are allocated
+together, so this is faster than n calls of SymTable_put. Inputs are
+SymTable_T oSymTable, const char *const *ppcKeys, const void *const
+*ppvValues, size_t n and int *piResults */
+
+size_t SymTable_putMany(SymTable_T oSymTable,
+   const char *const *ppcKeys, const void *const *ppvValues, size_t n,
+   int *piResults);
+
+/*--------------------------------------------------------------------*/
+
+/* Writes a snapshot of oSymTable to the file named pcPath, replacing
+its contents. Each binding is written as its key, its hash code and
+the bytes of its value, all in one sequential pass. *pfSaveValue
+stores the bytes of pvValue in the uSize bytes at pvBuffer and returns
+the number of bytes the value needs. If that is more than uSize, it is
+called again with a buffer big enough. Returns 1 (TRUE) on success, or
+0 (FALSE) if the file cannot be written, in which case its contents
+are unspecified. oSymTable must use the built-in hash function and key
+comparison, and must not be a table made by SymTable_newForAtoms.
+Inputs are SymTable_T oSymTable, const char *pcPath and the function
+size_t (*pfSaveValue)(const void *pvValue, void *pvBuffer, size_t
+uSize) */
+
+int SymTable_save(SymTable_T oSymTable, const char *pcPath,
+   size_t (*pfSaveValue)(const void *pvValue, void *pvBuffer,
+   size_t uSize));
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a new SymTable object that holds the bindings of the
+snapshot in the file named pcPath, as written by SymTable_save, or NULL
+if the file cannot be read, is not such a snapshot, or insufficient
+memory is available. *pfLoadValue makes a value from the uSize bytes
+at pvBytes that *pfSaveValue stored, stores it in *ppvValue and
+returns 1 (TRUE), or returns 0 (FALSE) to make SymTable_load fail. If
+the load fails after some values were made, each of them is passed to
+*pfFreeValue, unless pfFreeValue is NULL. The table keeps the
+snapshot's hash codes and seed, so keys are neither hashed nor
+compared as they are loaded. Counts and sizes in the file are checked
+against its length before memory is allocated for them. A snapshot
+can only be loaded by the same build of this module on the same kind
+of machine. Inputs are const char *pcPath and the functions int
+(*pfLoadValue)(const void *pvBytes, size_t uSize, void **ppvValue) and
+void (*pfFreeValue)(void *pvValue) */
+
+SymTable_T SymTable_load(const char *pcPath,
+   int (*pfLoadValue)(const void *pvBytes, size_t uSize,
+   void **ppvValue), void (*pfFreeValue)(void *pvValue));
+
+/*--------------------------------------------------------------------*/
+
+/* The position of an enumeration of the bindings of a SymTable, as
+started by SymTable_iterBegin. The caller provides the storage, so an
+enumeration allocates no memory. The fields are private to the
+implementation. */
+
+struct SymTableIter {
+   /* The table being enumerated */
+   SymTable_T oSymTable;
+   /* Index of the next bucket to look at once the current list is
+   done */
+   size_t bucket;
+   /* The next binding of the current list, or NULL */
+   void *pvBinding;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Starts an enumeration of the bindings of oSymTable at *psIter. Until
+the enumeration ends, oSymTable may be searched but must not be
+changed, except that SymTable_remove may remove the binding that
+SymTable_iterNext returned last. Inputs are SymTable_T oSymTable and
+struct SymTableIter *psIter */
+
+void SymTable_iterBegin(SymTable_T oSymTable,
+   struct SymTableIter *psIter);
+
+/*--------------------------------------------------------------------*/
+
+/* If the enumeration at *psIter has bindings left, stores the key and
+value of the next one in *ppcKey and *ppvValue and returns 1 (TRUE).
+Otherwise returns 0 (FALSE). Either of ppcKey and ppvValue may be NULL.
+Bindings come in no particular order, each exactly once. Empty buckets
+are skipped many at a time, so a sparse table is cheap to enumerate,
+and the caller may stop at any point. Inputs are struct SymTableIter
+*psIter, const char **ppcKey and void **ppvValue */
+
+int SymTable_iterNext(struct SymTableIter *psIter, const char **ppcKey,
+   void **ppvValue);
+
+/*--------------------------------------------------------------------*/
+
+/* The same as SymTable_map, except that the bindings are shared out
+among nThreads threads, the calling thread included, which apply
+*pfApply to them concurrently. *pfApply must therefore be safe to call
+from several threads at once for distinct bindings, in any order. The
+table must not be changed until SymTable_mapParallel returns. If
+threads cannot be started, the remaining threads do their work. Inputs
+are SymTable_T oSymTable, the function void (*pfApply)(const char
+*pcKey, void *pvValue, void *pvExtra), const void *pvExtra and size_t
+nThreads */
+
+void SymTable_mapParallel(SymTable_T oSymTable,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra, size_t nThreads);
+
+/*--------------------------------------------------------------------*/
+
+#endif
@@ -9,14 +9,14 @@
 #include <string.h>
 
 /* Each key/value is stored in a Node. Nodes are linked to form a 
-list */
+list. A Node and its key are a single allocation. */
 struct Node {
-   /* A string that uniquely identifies its binding */
-   char *key; 
-   /* Data that is somehow pertinent to its key */
-   void* value;
    /* A node that links the current Node with the next Node */
    struct Node *psNextNode;
+   /* Data that is somehow pertinent to its key */
+   void* value;
+   /* A string that uniquely identifies its binding, stored inline */
+   char key[]; 
    }; 
 
 /* Collection of key value pairs */
@@ -25,6 +25,9 @@ struct SymTable {
    struct Node *psFirstNode;
    /* Stores the number of bindings in a list */
    size_t length;
+   /* Number of SymTable_map calls in progress; the list is not
+   reordered while there are any */
+   size_t mapDepth;
    };
  
 /*--------------------------------------------------------------------*/
@@ -38,6 +41,7 @@ SymTable_T SymTable_new(void) {
 
    oSymTable->psFirstNode = NULL;
    oSymTable->length = 0; 
+   oSymTable->mapDepth = 0;
    return oSymTable;
 
 }
@@ -56,7 +60,6 @@ void SymTable_free(SymTable_T oSymTable) {
       psCurrentNode = psNextNode) {
    
       psNextNode = psCurrentNode->psNextNode;
-      free(psCurrentNode->key);
       free(psCurrentNode);
    }
 
@@ -73,46 +76,97 @@ size_t SymTable_getLength(SymTable_T oSymTable) {
 
 /*--------------------------------------------------------------------*/
 
-int SymTable_put(SymTable_T oSymTable,
-   const char *pcKey, const void *pvValue) {
-   
-   struct Node *psNewNode;
+/* Returns the node of oSymTable whose key is pcKey, or NULL if there
+is none. The node found is moved to the front of the list, so keys
+that are looked up often gather near the front and are found quickly,
+unless SymTable_map is walking the list. */
+
+static struct Node *SymTable_lookup(SymTable_T oSymTable,
+   const char *pcKey) {
+
    struct Node *psCurrentNode;
-   char *newKey;
+   struct Node *psPreviousNode;
 
    assert(oSymTable != NULL);
    assert(pcKey != NULL);
 
-   /* iterate */
+   psPreviousNode = NULL;
+
    for (psCurrentNode = oSymTable->psFirstNode;
       psCurrentNode != NULL;
       psCurrentNode = psCurrentNode->psNextNode) {
 
       if (strcmp(psCurrentNode->key, pcKey) == 0) {
-         return 0;
+         /* move to front */
+         if (psPreviousNode != NULL && oSymTable->mapDepth == 0) {
+            psPreviousNode->psNextNode = psCurrentNode->psNextNode;
+            psCurrentNode->psNextNode = oSymTable->psFirstNode;
+            oSymTable->psFirstNode = psCurrentNode;
+         }
+         return psCurrentNode;
       }
+
+      psPreviousNode = psCurrentNode;
    }
 
-   /* allocate new space for the node and key and rebind */
-   psNewNode = (struct Node*)malloc(sizeof(struct Node));
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the node of oSymTable whose key is pcKey and sets *piInserted
+to 0 (FALSE). If there is no such node, adds one of pcKey to pvValue
+at the front of the list, returns it and sets *piInserted to 1 (TRUE).
+If insufficient memory is available, leaves oSymTable unchanged and
+returns NULL. */
+
+static struct Node *SymTable_findOrAdd(SymTable_T oSymTable,
+   const char *pcKey, const void *pvValue, int *piInserted) {
+
+   struct Node *psNewNode;
+   size_t keyLength;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(piInserted != NULL);
+
+   *piInserted = 0;
+
+   /* check if present already */
+   psNewNode = SymTable_lookup(oSymTable, pcKey);
+   if (psNewNode != NULL)
+      return psNewNode;
+
+   /* allocate new space for the node and its key and rebind */
+   keyLength = strlen(pcKey);
+   psNewNode =
+      (struct Node*)malloc(sizeof(struct Node) + keyLength + 1);
    if (psNewNode == NULL)
-      return 0;
+      return NULL;
+   memcpy(psNewNode->key, pcKey, keyLength + 1);
+
    psNewNode->psNextNode = oSymTable->psFirstNode;
    oSymTable->psFirstNode = psNewNode;
-
-   newKey = (char*)malloc(strlen(pcKey) + 1);
-   if (newKey == NULL) {
-      free(psNewNode);
-      return 0;
-   }
-   strcpy(newKey, pcKey);
    oSymTable->length++;
 
-   psNewNode->key = newKey;
-
    psNewNode->value = (void*)pvValue;
 
-   return 1;
+   *piInserted = 1;
+   return psNewNode;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_put(SymTable_T oSymTable,
+   const char *pcKey, const void *pvValue) {
+
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   (void)SymTable_findOrAdd(oSymTable, pcKey, pvValue, &iInserted);
+   return iInserted;
 }
 
 /*--------------------------------------------------------------------*/
@@ -126,40 +180,64 @@ void *SymTable_replace(SymTable_T oSymTable,
    assert(oSymTable != NULL);
    assert(pcKey != NULL);
 
-   /* iterate, find, replace*/
-   for (psCurrentNode = oSymTable->psFirstNode;
-      psCurrentNode != NULL;
-      psCurrentNode = psCurrentNode->psNextNode) {
+   /* find, replace */
+   psCurrentNode = SymTable_lookup(oSymTable, pcKey);
+   if (psCurrentNode == NULL)
+      return NULL;
 
-      if (strcmp(psCurrentNode->key, pcKey) == 0) {
-         temp = psCurrentNode->value;
-         psCurrentNode->value = (void*)pvValue;
-         return temp;
-      }
+   temp = psCurrentNode->value;
+   psCurrentNode->value = (void*)pvValue;
+   return temp;
+}
 
-   }
-   return NULL;
+/*--------------------------------------------------------------------*/
+
+void **SymTable_findOrInsert(SymTable_T oSymTable, const char *pcKey,
+   const void *pvValue, int *piInserted) {
+
+   struct Node *psNode;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   psNode = SymTable_findOrAdd(oSymTable, pcKey, pvValue, &iInserted);
+   if (piInserted != NULL)
+      *piInserted = iInserted;
+   if (psNode == NULL)
+      return NULL;
+   return &psNode->value;
 }
 
 /*--------------------------------------------------------------------*/
 
-int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
-   
-   struct Node *psCurrentNode;
+int SymTable_upsert(SymTable_T oSymTable, const char *pcKey,
+   const void *pvValue) {
+
+   struct Node *psNode;
+   int iInserted;
 
    assert(oSymTable != NULL);
    assert(pcKey != NULL);
 
-   /* iterate and find match */
-   for (psCurrentNode = oSymTable->psFirstNode;
-      psCurrentNode != NULL;
-      psCurrentNode = psCurrentNode->psNextNode) {
+   /* one walk of the list either finds the binding or adds it */
+   psNode = SymTable_findOrAdd(oSymTable, pcKey, pvValue, &iInserted);
+   if (psNode == NULL)
+      return 0;
 
-      if (strcmp(psCurrentNode->key, pcKey) == 0) {
-         return 1;
-      }
-   }
-   return 0;
+   if (! iInserted)
+      psNode->value = (void*)pvValue;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   return SymTable_lookup(oSymTable, pcKey) != NULL;
 }
 
 /*--------------------------------------------------------------------*/
@@ -171,17 +249,12 @@ void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
    assert(oSymTable != NULL);
    assert(pcKey != NULL);
 
-   /* iterate and return value when found */
-   for (psCurrentNode = oSymTable->psFirstNode;
-      psCurrentNode != NULL;
-      psCurrentNode = psCurrentNode->psNextNode) {
-
-      if (strcmp(psCurrentNode->key, pcKey) == 0) {
-         return psCurrentNode->value;
-      }
-   }
+   /* return value when found */
+   psCurrentNode = SymTable_lookup(oSymTable, pcKey);
+   if (psCurrentNode == NULL)
+      return NULL;
 
-   return NULL;
+   return psCurrentNode->value;
 }
 
 /*--------------------------------------------------------------------*/
@@ -205,7 +278,6 @@ void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
          temp = psPreviousNode->value;
          oSymTable->psFirstNode = psPreviousNode->psNextNode;
 
-         free(psPreviousNode->key);
          free(psPreviousNode);
          oSymTable->length--;
          return temp;
@@ -220,7 +292,6 @@ void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
          temp = psCurrentNode->value;
          psPreviousNode->psNextNode = psCurrentNode->psNextNode;
 
-         free(psCurrentNode->key);
          free(psCurrentNode);
          oSymTable->length--;
          return temp;
@@ -245,6 +316,9 @@ void SymTable_map(SymTable_T oSymTable,
    assert(oSymTable != NULL);
    assert(pfApply != NULL);
 
+   /* *pfApply may look up keys, which must not reorder the list 
+   under this walk */
+   oSymTable->mapDepth++;
    for (psCurrentNode = oSymTable->psFirstNode;
       psCurrentNode != NULL;
       psCurrentNode = psCurrentNode->psNextNode) {
@@ -254,6 +328,7 @@ void SymTable_map(SymTable_T oSymTable,
       /* applies the function to each binding */
       (*pfApply)(key, value, (void*)pvExtra);
    }
+   oSymTable->mapDepth--;
 }
 
 /*--------------------------------------------------------------------*/
\ No newline at end of file
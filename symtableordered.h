@@ -0,0 +1,51 @@
+/*--------------------------------------------------------------------*/
+/* symtableordered.h                                                  */
+/* Author: Angel Chang Liu                                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLEORDERED_included
+#define SYMTABLEORDERED_included
+#include "symtable.h"
+
+/* Extensions to the SymTable interface that the ordered
+implementations (symtablebtree.c and symtableart.c) provide. They keep
+their bindings sorted by key, as strcmp orders keys, and their
+SymTable_map visits the bindings in that order. The key that their
+SymTable_map, SymTable_mapRange and SymTable_mapPrefix pass to
+*pfApply is valid only until *pfApply returns, since symtableart.c
+rebuilds each key from its path through the tree. */
+
+/*--------------------------------------------------------------------*/
+
+/* SymTable_mapRange applies function *pfApply to each binding in
+oSymTable whose key is at least pcLow and less than pcHigh, in
+ascending order of the keys, passing pvExtra as an extra parameter. A
+NULL pcLow or pcHigh leaves the range open at that end. Only the
+bindings in the range are visited, after a search for the first one.
+*pfApply must not change oSymTable. Inputs are SymTable_T oSymTable,
+const char *pcLow, const char *pcHigh, the function void
+(*pfApply)(const char *pcKey, void *pvValue, void *pvExtra) and const
+void *pvExtra */
+
+void SymTable_mapRange(SymTable_T oSymTable, const char *pcLow,
+   const char *pcHigh,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra);
+
+/*--------------------------------------------------------------------*/
+
+/* SymTable_mapPrefix applies function *pfApply to each binding in
+oSymTable whose key starts with pcPrefix, in ascending order of the
+keys, passing pvExtra as an extra parameter. Those keys are adjacent
+in the order, so only they are visited, after a search for the first
+one. *pfApply must not change oSymTable. Inputs are SymTable_T
+oSymTable, const char *pcPrefix, the function void (*pfApply)(const
+char *pcKey, void *pvValue, void *pvExtra) and const void *pvExtra */
+
+void SymTable_mapPrefix(SymTable_T oSymTable, const char *pcPrefix,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra);
+
+/*--------------------------------------------------------------------*/
+
+#endif
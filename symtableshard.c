@@ -0,0 +1,268 @@
+/*--------------------------------------------------------------------*/
+/* symtableshard.c                                                    */
+/* Author: Angel Chang Liu                                            */
+/*--------------------------------------------------------------------*/
+
+#include "symtableshard.h"
+#include "symtable.h"
+#include "symtablestrhash.h"
+#include <stdlib.h>
+#include <assert.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#ifndef __GNUC__
+#error "symtableshard.c needs the __atomic builtins of GCC or Clang"
+#endif
+
+/* Assumed size of a cache line. Shards are kept at least this far
+apart, so that locking one shard does not slow down threads that use
+its neighbours. */
+enum {CACHE_LINE_SIZE = 64};
+
+/* One shard: a SymTable and the lock that guards it */
+struct Shard {
+   /* Held by every call that uses oSymTable, since even lookups in a
+   SymTable may move its bindings */
+   pthread_mutex_t mutex;
+   /* The bindings of the keys that belong to this shard */
+   SymTable_T oSymTable;
+   /* SymTable_getLength(oSymTable), kept where other threads may read
+   it without the lock */
+   size_t numBindings;
+   char acPad[CACHE_LINE_SIZE];
+};
+
+/* Collection of key value pairs, split among shards */
+struct ShardSymTable {
+   /* Stores the number of shards */
+   size_t numShards;
+   /* The shards */
+   struct Shard aShards[];
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the shard of the input oShardSymTable that pcKey belongs
+to, locked. The shard is picked by multiplying the high 32 bits of the
+hash code by the shard count, which works for any count. */
+
+static struct Shard *ShardSymTable_lock(ShardSymTable_T oShardSymTable,
+   const char *pcKey) {
+
+   struct Shard *psShard;
+
+   assert(oShardSymTable != NULL);
+   assert(pcKey != NULL);
+
+   psShard = &oShardSymTable->aShards[(size_t)(
+      (SymTable_strhash(pcKey) >> 32) *
+      (uint64_t)oShardSymTable->numShards >> 32)];
+   pthread_mutex_lock(&psShard->mutex);
+   return psShard;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Unlock the input psShard, after recording its binding count for
+ShardSymTable_getLength. */
+
+static void ShardSymTable_unlock(struct Shard *psShard) {
+   assert(psShard != NULL);
+
+   __atomic_store_n(&psShard->numBindings,
+      SymTable_getLength(psShard->oSymTable), __ATOMIC_RELAXED);
+   pthread_mutex_unlock(&psShard->mutex);
+}
+
+/*--------------------------------------------------------------------*/
+
+ShardSymTable_T ShardSymTable_new(size_t numShards) {
+   ShardSymTable_T oShardSymTable;
+   size_t i;
+
+   assert(numShards >= 1);
+
+   /* allocate new memory */
+   oShardSymTable = (ShardSymTable_T)malloc(
+      sizeof(struct ShardSymTable) + numShards * sizeof(struct Shard));
+   if (oShardSymTable == NULL)
+      return NULL;
+
+   for (i = 0; i < numShards; i++) {
+      oShardSymTable->aShards[i].oSymTable = SymTable_new();
+      if (oShardSymTable->aShards[i].oSymTable == NULL)
+         break;
+      if (pthread_mutex_init(&oShardSymTable->aShards[i].mutex, NULL)
+         != 0) {
+         SymTable_free(oShardSymTable->aShards[i].oSymTable);
+         break;
+      }
+      oShardSymTable->aShards[i].numBindings = 0;
+   }
+
+   /* undo the shards made so far if one could not be made */
+   if (i < numShards) {
+      while (i > 0) {
+         i--;
+         pthread_mutex_destroy(&oShardSymTable->aShards[i].mutex);
+         SymTable_free(oShardSymTable->aShards[i].oSymTable);
+      }
+      free(oShardSymTable);
+      return NULL;
+   }
+
+   oShardSymTable->numShards = numShards;
+   return oShardSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+void ShardSymTable_free(ShardSymTable_T oShardSymTable) {
+   size_t i;
+
+   assert(oShardSymTable != NULL);
+
+   for (i = 0; i < oShardSymTable->numShards; i++) {
+      pthread_mutex_destroy(&oShardSymTable->aShards[i].mutex);
+      SymTable_free(oShardSymTable->aShards[i].oSymTable);
+   }
+   free(oShardSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t ShardSymTable_getLength(ShardSymTable_T oShardSymTable) {
+   size_t uLength = 0;
+   size_t i;
+
+   assert(oShardSymTable != NULL);
+
+   for (i = 0; i < oShardSymTable->numShards; i++)
+      uLength += __atomic_load_n(&oShardSymTable->aShards[i].numBindings,
+         __ATOMIC_RELAXED);
+   return uLength;
+}
+
+/*--------------------------------------------------------------------*/
+
+int ShardSymTable_put(ShardSymTable_T oShardSymTable,
+   const char *pcKey, const void *pvValue) {
+
+   struct Shard *psShard;
+   int iSuccessful;
+
+   assert(oShardSymTable != NULL);
+   assert(pcKey != NULL);
+
+   psShard = ShardSymTable_lock(oShardSymTable, pcKey);
+   iSuccessful = SymTable_put(psShard->oSymTable, pcKey, pvValue);
+   ShardSymTable_unlock(psShard);
+   return iSuccessful;
+}
+
+/*--------------------------------------------------------------------*/
+
+int ShardSymTable_upsert(ShardSymTable_T oShardSymTable,
+   const char *pcKey, const void *pvValue) {
+
+   struct Shard *psShard;
+   int iSuccessful;
+
+   assert(oShardSymTable != NULL);
+   assert(pcKey != NULL);
+
+   psShard = ShardSymTable_lock(oShardSymTable, pcKey);
+   iSuccessful = SymTable_upsert(psShard->oSymTable, pcKey, pvValue);
+   ShardSymTable_unlock(psShard);
+   return iSuccessful;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *ShardSymTable_replace(ShardSymTable_T oShardSymTable,
+   const char *pcKey, const void *pvValue) {
+
+   struct Shard *psShard;
+   void *temp;
+
+   assert(oShardSymTable != NULL);
+   assert(pcKey != NULL);
+
+   psShard = ShardSymTable_lock(oShardSymTable, pcKey);
+   temp = SymTable_replace(psShard->oSymTable, pcKey, pvValue);
+   ShardSymTable_unlock(psShard);
+   return temp;
+}
+
+/*--------------------------------------------------------------------*/
+
+int ShardSymTable_contains(ShardSymTable_T oShardSymTable,
+   const char *pcKey) {
+
+   struct Shard *psShard;
+   int iFound;
+
+   assert(oShardSymTable != NULL);
+   assert(pcKey != NULL);
+
+   psShard = ShardSymTable_lock(oShardSymTable, pcKey);
+   iFound = SymTable_contains(psShard->oSymTable, pcKey);
+   ShardSymTable_unlock(psShard);
+   return iFound;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *ShardSymTable_get(ShardSymTable_T oShardSymTable,
+   const char *pcKey) {
+
+   struct Shard *psShard;
+   void *value;
+
+   assert(oShardSymTable != NULL);
+   assert(pcKey != NULL);
+
+   psShard = ShardSymTable_lock(oShardSymTable, pcKey);
+   value = SymTable_get(psShard->oSymTable, pcKey);
+   ShardSymTable_unlock(psShard);
+   return value;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *ShardSymTable_remove(ShardSymTable_T oShardSymTable,
+   const char *pcKey) {
+
+   struct Shard *psShard;
+   void *temp;
+
+   assert(oShardSymTable != NULL);
+   assert(pcKey != NULL);
+
+   psShard = ShardSymTable_lock(oShardSymTable, pcKey);
+   temp = SymTable_remove(psShard->oSymTable, pcKey);
+   ShardSymTable_unlock(psShard);
+   return temp;
+}
+
+/*--------------------------------------------------------------------*/
+
+void ShardSymTable_map(ShardSymTable_T oShardSymTable,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+
+   size_t i;
+
+   assert(oShardSymTable != NULL);
+   assert(pfApply != NULL);
+
+   for (i = 0; i < oShardSymTable->numShards; i++) {
+      pthread_mutex_lock(&oShardSymTable->aShards[i].mutex);
+      SymTable_map(oShardSymTable->aShards[i].oSymTable, pfApply,
+         pvExtra);
+      ShardSymTable_unlock(&oShardSymTable->aShards[i]);
+   }
+}
+
+/*--------------------------------------------------------------------*/
@@ -0,0 +1,82 @@
+/*--------------------------------------------------------------------*/
+/* symtableshard.h                                                    */
+/* Author: Angel Chang Liu                                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLESHARD_included
+#define SYMTABLESHARD_included
+#include <stddef.h>
+
+/* A ShardSymTable_T is a collection of key/value pairs that several
+threads may use at once. Its keys are split by hash code among a fixed
+number of shards, each a separate SymTable (symtablehash.c) with its
+own lock and allocator, so threads working on different shards run in
+parallel. Apart from that, each function behaves as the SymTable
+function of the same name. */
+
+typedef struct ShardSymTable *ShardSymTable_T;
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a new ShardSymTable object with numShards shards that
+contains no bindings, or NULL if insufficient memory is available.
+numShards must be at least 1; more shards than threads using the table
+make collisions between threads rare. Input is size_t numShards */
+
+ShardSymTable_T ShardSymTable_new(size_t numShards);
+
+/*--------------------------------------------------------------------*/
+
+/* Frees all memory occupied by the input oShardSymTable, which no
+other thread may be using */
+
+void ShardSymTable_free(ShardSymTable_T oShardSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the number of bindings in the input oShardSymTable, summed
+over its shards without locking them. While other threads change the
+table, the result may miss their latest changes. */
+
+size_t ShardSymTable_getLength(ShardSymTable_T oShardSymTable);
+
+/*--------------------------------------------------------------------*/
+
+/* The same as SymTable_put, SymTable_upsert, SymTable_replace,
+SymTable_contains, SymTable_get and SymTable_remove respectively, for
+the shard of oShardSymTable that pcKey belongs to. */
+
+int ShardSymTable_put(ShardSymTable_T oShardSymTable,
+   const char *pcKey, const void *pvValue);
+
+int ShardSymTable_upsert(ShardSymTable_T oShardSymTable,
+   const char *pcKey, const void *pvValue);
+
+void *ShardSymTable_replace(ShardSymTable_T oShardSymTable,
+   const char *pcKey, const void *pvValue);
+
+int ShardSymTable_contains(ShardSymTable_T oShardSymTable,
+   const char *pcKey);
+
+void *ShardSymTable_get(ShardSymTable_T oShardSymTable,
+   const char *pcKey);
+
+void *ShardSymTable_remove(ShardSymTable_T oShardSymTable,
+   const char *pcKey);
+
+/*--------------------------------------------------------------------*/
+
+/* ShardSymTable_map applies function *pfApply to each binding in
+oShardSymTable, passing pvExtra as an extra parameter, one shard at a
+time. Each shard is locked while its bindings are visited, so *pfApply
+must not use oShardSymTable. Inputs are ShardSymTable_T
+oShardSymTable, the function void (*pfApply)(const char *pcKey, void
+*pvValue, void *pvExtra) and const void *pvExtra */
+
+void ShardSymTable_map(ShardSymTable_T oShardSymTable,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra);
+
+/*--------------------------------------------------------------------*/
+
+#endif
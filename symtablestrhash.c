@@ -0,0 +1,32 @@
+/*--------------------------------------------------------------------*/
+/* symtablestrhash.c                                                  */
+/* Author: Angel Chang Liu                                            */
+/*--------------------------------------------------------------------*/
+
+#include "symtablestrhash.h"
+#include <assert.h>
+#include <stddef.h>
+
+/*--------------------------------------------------------------------*/
+
+uint64_t SymTable_strhash(const char *pcKey) {
+   const uint64_t HASH_MULTIPLIER = 65599;
+   size_t u;
+   uint64_t uHash = 0;
+
+   assert(pcKey != NULL);
+
+   for (u = 0; pcKey[u] != '\0'; u++)
+      uHash = uHash * HASH_MULTIPLIER +
+         (uint64_t)(unsigned char)pcKey[u];
+
+   /* the 64-bit finalizer of MurmurHash3 */
+   uHash ^= uHash >> 33;
+   uHash *= UINT64_C(0xff51afd7ed558ccd);
+   uHash ^= uHash >> 33;
+   uHash *= UINT64_C(0xc4ceb9fe1a85ec53);
+   uHash ^= uHash >> 33;
+   return uHash;
+}
+
+/*--------------------------------------------------------------------*/
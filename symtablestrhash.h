@@ -0,0 +1,26 @@
+/*--------------------------------------------------------------------*/
+/* symtablestrhash.h                                                  */
+/* Author: Angel Chang Liu                                            */
+/*--------------------------------------------------------------------*/
+
+#ifndef SYMTABLESTRHASH_included
+#define SYMTABLESTRHASH_included
+#include <stdint.h>
+
+/* The string hash function shared by the implementations that do not
+seed their hash codes (symtableswiss.c, symtableconc.c,
+symtableepoch.c and symtableshard.c). It is internal to them, not part
+of the SymTable interface. */
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a 64-bit hash code for pcKey. The classic 65599 hash is
+followed by a finalizer that mixes every input bit into every bit of
+the result, so callers may take any bits of it: the low bits to pick a
+bucket or stripe, the high bits to pick a shard. */
+
+uint64_t SymTable_strhash(const char *pcKey);
+
+/*--------------------------------------------------------------------*/
+
+#endif
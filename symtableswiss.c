@@ -0,0 +1,605 @@
+/*--------------------------------------------------------------------*/
+/* symtableswiss.c                                                    */
+/* Author: Angel Chang Liu                                            */
+/*--------------------------------------------------------------------*/
+
+#include "symtable.h"
+#include "symtablestrhash.h"
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* The table is open addressed: bindings live directly in a flat array
+of slots, and a parallel array holds one control byte per slot. A
+control byte is either EMPTY, DELETED, or the low 7 bits of the hash of
+the key in its slot. Lookups compare GROUP_WIDTH control bytes at once
+and only look at the slots whose control byte matches. */
+
+/* number of control bytes probed at once */
+enum {GROUP_WIDTH = 16};
+
+/* smallest number of slots, must be a power of two >= GROUP_WIDTH */
+enum {MIN_CAPACITY = 16};
+
+/* control byte values for slots that do not hold a binding */
+enum {CTRL_EMPTY = -128, CTRL_DELETED = -2};
+
+/* size of the buffer in a slot that holds a short key; keys of up to
+INLINE_KEY_SIZE - 1 characters are stored in the slot itself */
+enum {INLINE_KEY_SIZE = 16};
+
+/* Each key/value is stored in a Slot. */
+struct Slot {
+   /* A string that uniquely identifies its binding. A short key is
+   stored in acInline, whose last byte is then 0 ('\0'); a longer key
+   is stored in memory of its own that pcHeap points to, and the last
+   byte of acInline is then 1. */
+   union {
+      char acInline[INLINE_KEY_SIZE];
+      char *pcHeap;
+   } key;
+   /* Data that is somehow pertinent to its key */
+   void *value;
+};
+
+/* Collection of key value pairs */
+struct SymTable {
+   /* capacity + GROUP_WIDTH control bytes; the last GROUP_WIDTH mirror
+   the first so a group can be loaded at any slot index */
+   signed char *ctrl;
+   /* capacity slots, where slots[i] is in use iff ctrl[i] >= 0 */
+   struct Slot *slots;
+   /* Stores the number of slots, always a power of two */
+   size_t capacity;
+   /* Stores the number of bindings */
+   size_t numBindings;
+   /* Number of EMPTY slots that may still be filled before the table
+   must be rebuilt; DELETED slots do not count as free */
+   size_t growthLeft;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the key of the binding in psSlot, wherever it is stored. */
+
+static const char *SymTable_slotKey(const struct Slot *psSlot)
+{
+   assert(psSlot != NULL);
+
+   if (psSlot->key.acInline[INLINE_KEY_SIZE - 1] == '\0')
+      return psSlot->key.acInline;
+   return psSlot->key.pcHeap;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Frees the memory of the key of the binding in psSlot, if the key
+has memory of its own. */
+
+static void SymTable_freeKey(struct Slot *psSlot)
+{
+   assert(psSlot != NULL);
+
+   if (psSlot->key.acInline[INLINE_KEY_SIZE - 1] != '\0')
+      free(psSlot->key.pcHeap);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the number of slots whose ctrl bytes may be filled before
+a table with uCapacity slots must grow: 7/8 of them. */
+
+static size_t SymTable_maxLoad(size_t uCapacity)
+{
+   return uCapacity - uCapacity / 8;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the index of the lowest set bit of the nonzero uMask. */
+
+static unsigned SymTable_lowestBit(unsigned uMask)
+{
+#ifdef __GNUC__
+   return (unsigned)__builtin_ctz(uMask);
+#else
+   unsigned u = 0;
+   assert(uMask != 0);
+   while ((uMask & 1U) == 0) {
+      uMask >>= 1;
+      u++;
+   }
+   return u;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a mask with bit i set for each of the GROUP_WIDTH control
+bytes starting at pcGroup that equals cByte. */
+
+static unsigned SymTable_matchByte(const signed char *pcGroup,
+   signed char cByte)
+{
+#ifdef __SSE2__
+   __m128i group = _mm_loadu_si128((const __m128i*)(const void*)pcGroup);
+   return (unsigned)_mm_movemask_epi8(
+      _mm_cmpeq_epi8(group, _mm_set1_epi8(cByte)));
+#else
+   unsigned uMask = 0;
+   int i;
+   for (i = 0; i < GROUP_WIDTH; i++)
+      if (pcGroup[i] == cByte)
+         uMask |= 1U << i;
+   return uMask;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a mask with bit i set for each of the GROUP_WIDTH control
+bytes starting at pcGroup that is EMPTY or DELETED. */
+
+static unsigned SymTable_matchFree(const signed char *pcGroup)
+{
+#ifdef __SSE2__
+   /* EMPTY and DELETED are exactly the bytes with the sign bit set */
+   return (unsigned)_mm_movemask_epi8(
+      _mm_loadu_si128((const __m128i*)(const void*)pcGroup));
+#else
+   unsigned uMask = 0;
+   int i;
+   for (i = 0; i < GROUP_WIDTH; i++)
+      if (pcGroup[i] < 0)
+         uMask |= 1U << i;
+   return uMask;
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Sets the control byte of slot uIndex of oSymTable to cByte, keeping
+the mirrored bytes past the end of ctrl up to date. */
+
+static void SymTable_setCtrl(SymTable_T oSymTable, size_t uIndex,
+   signed char cByte)
+{
+   assert(oSymTable != NULL);
+   assert(uIndex < oSymTable->capacity);
+
+   oSymTable->ctrl[uIndex] = cByte;
+   if (uIndex < GROUP_WIDTH)
+      oSymTable->ctrl[oSymTable->capacity + uIndex] = cByte;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the index of the slot of oSymTable holding the binding whose
+key is pcKey, given uHash = SymTable_strhash(pcKey), or
+oSymTable->capacity if there is no such binding. */
+
+static size_t SymTable_find(SymTable_T oSymTable, const char *pcKey,
+   uint64_t uHash)
+{
+   size_t uMask;
+   size_t uPos;
+   size_t uStep;
+   size_t uIndex;
+   unsigned uMatches;
+   signed char cH2;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   uMask = oSymTable->capacity - 1;
+   cH2 = (signed char)(uHash & 0x7F);
+   uPos = (size_t)(uHash >> 7) & uMask;
+
+   /* probe group by group, with triangular steps */
+   for (uStep = GROUP_WIDTH; ; uStep += GROUP_WIDTH) {
+      uMatches = SymTable_matchByte(oSymTable->ctrl + uPos, cH2);
+      while (uMatches != 0) {
+         uIndex = (uPos + SymTable_lowestBit(uMatches)) & uMask;
+         if (strcmp(SymTable_slotKey(&oSymTable->slots[uIndex]),
+            pcKey) == 0)
+            return uIndex;
+         uMatches &= uMatches - 1;
+      }
+      /* an EMPTY byte ends every probe sequence that reached it */
+      if (SymTable_matchByte(oSymTable->ctrl + uPos, CTRL_EMPTY) != 0)
+         return oSymTable->capacity;
+      uPos = (uPos + uStep) & uMask;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the index of the first EMPTY or DELETED slot of oSymTable on
+the probe sequence for uHash. */
+
+static size_t SymTable_findFree(SymTable_T oSymTable, uint64_t uHash)
+{
+   size_t uMask;
+   size_t uPos;
+   size_t uStep;
+   unsigned uFree;
+
+   assert(oSymTable != NULL);
+
+   uMask = oSymTable->capacity - 1;
+   uPos = (size_t)(uHash >> 7) & uMask;
+
+   for (uStep = GROUP_WIDTH; ; uStep += GROUP_WIDTH) {
+      uFree = SymTable_matchFree(oSymTable->ctrl + uPos);
+      if (uFree != 0)
+         return (uPos + SymTable_lowestBit(uFree)) & uMask;
+      uPos = (uPos + uStep) & uMask;
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Allocates EMPTY ctrl and slots arrays of uCapacity slots for
+oSymTable. Returns 1 (TRUE) on success, or 0 (FALSE) and leaves
+oSymTable unchanged if insufficient memory is available. */
+
+static int SymTable_allocSlots(SymTable_T oSymTable, size_t uCapacity)
+{
+   signed char *newCtrl;
+   struct Slot *newSlots;
+
+   assert(oSymTable != NULL);
+
+   newCtrl = (signed char*)malloc(uCapacity + GROUP_WIDTH);
+   if (newCtrl == NULL)
+      return 0;
+   newSlots = (struct Slot*)malloc(uCapacity * sizeof(struct Slot));
+   if (newSlots == NULL) {
+      free(newCtrl);
+      return 0;
+   }
+   memset(newCtrl, CTRL_EMPTY, uCapacity + GROUP_WIDTH);
+
+   oSymTable->ctrl = newCtrl;
+   oSymTable->slots = newSlots;
+   oSymTable->capacity = uCapacity;
+   oSymTable->growthLeft = SymTable_maxLoad(uCapacity);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Rebuilds oSymTable with enough slots for one more binding, dropping
+all DELETED slots. The capacity doubles unless the table is mostly
+tombstones. Returns 1 (TRUE) on success, or 0 (FALSE) and leaves
+oSymTable unchanged if insufficient memory is available. */
+
+static int SymTable_rehash(SymTable_T oSymTable)
+{
+   signed char *oldCtrl;
+   struct Slot *oldSlots;
+   size_t oldCapacity;
+   size_t newCapacity;
+   size_t u;
+   size_t uIndex;
+   uint64_t uHash;
+
+   assert(oSymTable != NULL);
+
+   oldCtrl = oSymTable->ctrl;
+   oldSlots = oSymTable->slots;
+   oldCapacity = oSymTable->capacity;
+
+   newCapacity = oldCapacity;
+   if (oSymTable->numBindings + 1 > SymTable_maxLoad(oldCapacity) / 2)
+      newCapacity = oldCapacity * 2;
+
+   if (! SymTable_allocSlots(oSymTable, newCapacity))
+      return 0;
+
+   for (u = 0; u < oldCapacity; u++) {
+      if (oldCtrl[u] < 0)
+         continue;
+      uHash = SymTable_strhash(SymTable_slotKey(&oldSlots[u]));
+      uIndex = SymTable_findFree(oSymTable, uHash);
+      SymTable_setCtrl(oSymTable, uIndex, (signed char)(uHash & 0x7F));
+      oSymTable->slots[uIndex] = oldSlots[u];
+   }
+   oSymTable->growthLeft -= oSymTable->numBindings;
+
+   free(oldCtrl);
+   free(oldSlots);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+SymTable_T SymTable_new(void) {
+   SymTable_T oSymTable;
+
+   /* allocate new memory */
+   oSymTable = (SymTable_T)malloc(sizeof(struct SymTable));
+   if (oSymTable == NULL)
+      return NULL;
+
+   if (! SymTable_allocSlots(oSymTable, MIN_CAPACITY)) {
+      free(oSymTable);
+      return NULL;
+   }
+   oSymTable->numBindings = 0;
+
+   return oSymTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_free(SymTable_T oSymTable) {
+   size_t u;
+
+   assert(oSymTable != NULL);
+
+   for (u = 0; u < oSymTable->capacity; u++)
+      if (oSymTable->ctrl[u] >= 0)
+         SymTable_freeKey(&oSymTable->slots[u]);
+
+   free(oSymTable->ctrl);
+   free(oSymTable->slots);
+   free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t SymTable_getLength(SymTable_T oSymTable) {
+   assert(oSymTable != NULL);
+
+   return oSymTable->numBindings;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns the index of the slot of oSymTable holding the binding whose
+key is pcKey, given uHash = SymTable_strhash(pcKey), and sets
+*piInserted to 0 (FALSE). If there is no such binding, adds one of
+pcKey to pvValue, returns its index and sets *piInserted to 1 (TRUE).
+If insufficient memory is available, leaves oSymTable unchanged and
+returns oSymTable->capacity. */
+
+static size_t SymTable_findOrAdd(SymTable_T oSymTable,
+   const char *pcKey, uint64_t uHash, const void *pvValue,
+   int *piInserted)
+{
+   size_t uIndex;
+   size_t keyLength;
+   char *newKey = NULL;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+   assert(piInserted != NULL);
+
+   *piInserted = 0;
+
+   /* check if present already */
+   uIndex = SymTable_find(oSymTable, pcKey, uHash);
+   if (uIndex != oSymTable->capacity)
+      return uIndex;
+
+   /* only a key too long for the slot needs memory of its own */
+   keyLength = strlen(pcKey);
+   if (keyLength >= INLINE_KEY_SIZE) {
+      newKey = (char*)malloc(keyLength + 1);
+      if (newKey == NULL)
+         return oSymTable->capacity;
+      memcpy(newKey, pcKey, keyLength + 1);
+   }
+
+   uIndex = SymTable_findFree(oSymTable, uHash);
+
+   /* reusing a DELETED slot costs nothing; taking an EMPTY one may
+   require the table to be rebuilt first */
+   if (oSymTable->ctrl[uIndex] == CTRL_EMPTY &&
+      oSymTable->growthLeft == 0) {
+      if (! SymTable_rehash(oSymTable)) {
+         free(newKey);
+         return oSymTable->capacity;
+      }
+      uIndex = SymTable_findFree(oSymTable, uHash);
+   }
+
+   if (oSymTable->ctrl[uIndex] == CTRL_EMPTY)
+      oSymTable->growthLeft--;
+   SymTable_setCtrl(oSymTable, uIndex, (signed char)(uHash & 0x7F));
+   if (newKey == NULL) {
+      memcpy(oSymTable->slots[uIndex].key.acInline, pcKey,
+         keyLength + 1);
+      oSymTable->slots[uIndex].key.acInline[INLINE_KEY_SIZE - 1] = '\0';
+   }
+   else {
+      oSymTable->slots[uIndex].key.pcHeap = newKey;
+      oSymTable->slots[uIndex].key.acInline[INLINE_KEY_SIZE - 1] = 1;
+   }
+   oSymTable->slots[uIndex].value = (void*)pvValue;
+
+   oSymTable->numBindings++;
+
+   *piInserted = 1;
+   return uIndex;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_put(SymTable_T oSymTable,
+   const char *pcKey, const void *pvValue) {
+
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   (void)SymTable_findOrAdd(oSymTable, pcKey, SymTable_strhash(pcKey),
+      pvValue, &iInserted);
+   return iInserted;
+}
+
+/*--------------------------------------------------------------------*/
+
+void **SymTable_findOrInsert(SymTable_T oSymTable, const char *pcKey,
+   const void *pvValue, int *piInserted) {
+
+   size_t uIndex;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   uIndex = SymTable_findOrAdd(oSymTable, pcKey,
+      SymTable_strhash(pcKey), pvValue, &iInserted);
+   if (piInserted != NULL)
+      *piInserted = iInserted;
+   if (uIndex == oSymTable->capacity)
+      return NULL;
+
+   return &oSymTable->slots[uIndex].value;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_upsert(SymTable_T oSymTable, const char *pcKey,
+   const void *pvValue) {
+
+   void **ppvValue;
+   int iInserted;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   /* one probe sequence either finds the binding or adds it */
+   ppvValue = SymTable_findOrInsert(oSymTable, pcKey, pvValue,
+      &iInserted);
+   if (ppvValue == NULL)
+      return 0;
+
+   if (! iInserted)
+      *ppvValue = (void*)pvValue;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_replace(SymTable_T oSymTable,
+   const char *pcKey, const void *pvValue) {
+
+   void *temp;
+   size_t uIndex;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   uIndex = SymTable_find(oSymTable, pcKey, SymTable_strhash(pcKey));
+   if (uIndex == oSymTable->capacity)
+      return NULL;
+
+   temp = oSymTable->slots[uIndex].value;
+   oSymTable->slots[uIndex].value = (void*)pvValue;
+   return temp;
+}
+
+/*--------------------------------------------------------------------*/
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   return SymTable_find(oSymTable, pcKey, SymTable_strhash(pcKey))
+      != oSymTable->capacity;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+
+   size_t uIndex;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   uIndex = SymTable_find(oSymTable, pcKey, SymTable_strhash(pcKey));
+   if (uIndex == oSymTable->capacity)
+      return NULL;
+
+   return oSymTable->slots[uIndex].value;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+
+   void *temp;
+   size_t uIndex;
+   size_t uMask;
+   unsigned uEmptyBefore;
+   unsigned uEmptyAfter;
+   unsigned uRun;
+
+   assert(oSymTable != NULL);
+   assert(pcKey != NULL);
+
+   uIndex = SymTable_find(oSymTable, pcKey, SymTable_strhash(pcKey));
+   if (uIndex == oSymTable->capacity)
+      return NULL;
+
+   temp = oSymTable->slots[uIndex].value;
+   SymTable_freeKey(&oSymTable->slots[uIndex]);
+   oSymTable->numBindings--;
+
+   /* If no window of GROUP_WIDTH bytes covering this slot was ever
+   completely full, no probe sequence has passed over it, so it may
+   go back to EMPTY. Otherwise it must become a DELETED tombstone. */
+   uMask = oSymTable->capacity - 1;
+   uEmptyBefore = SymTable_matchByte(oSymTable->ctrl +
+      ((uIndex - GROUP_WIDTH) & uMask), CTRL_EMPTY);
+   uEmptyAfter = SymTable_matchByte(oSymTable->ctrl + uIndex,
+      CTRL_EMPTY);
+   uRun = 0;
+   if (uEmptyBefore != 0 && uEmptyAfter != 0) {
+      /* full bytes just before uIndex plus full bytes from uIndex */
+      while ((uEmptyBefore & (1U << (GROUP_WIDTH - 1 - uRun))) == 0)
+         uRun++;
+      uRun += SymTable_lowestBit(uEmptyAfter);
+   }
+
+   if (uEmptyBefore != 0 && uEmptyAfter != 0 && uRun < GROUP_WIDTH) {
+      SymTable_setCtrl(oSymTable, uIndex, CTRL_EMPTY);
+      oSymTable->growthLeft++;
+   }
+   else
+      SymTable_setCtrl(oSymTable, uIndex, CTRL_DELETED);
+
+   return temp;
+}
+
+/*--------------------------------------------------------------------*/
+
+void SymTable_map(SymTable_T oSymTable,
+   void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+   const void *pvExtra) {
+
+   size_t u;
+
+   assert(oSymTable != NULL);
+   assert(pfApply != NULL);
+
+   for (u = 0; u < oSymTable->capacity; u++) {
+      /* apply the function on each binding */
+      if (oSymTable->ctrl[u] >= 0)
+         (*pfApply)(SymTable_slotKey(&oSymTable->slots[u]),
+            oSymTable->slots[u].value, (void*)pvExtra);
+   }
+}
+
+/*--------------------------------------------------------------------*/
@@ -572,6 +572,94 @@ static void testNullValue(void)
 
 /*--------------------------------------------------------------------*/
 
+/* Test SymTable_upsert() and SymTable_findOrInsert(), including
+   updating a value in place through the address that
+   SymTable_findOrInsert() returns. */
+
+static void testUpsert(void)
+{
+   enum {WORD_COUNT = 7};
+
+   SymTable_T oSymTable;
+   const char *apcWords[WORD_COUNT] =
+      {"Ruth", "Gehrig", "Ruth", "Mantle", "Ruth", "Gehrig", "Jeter"};
+   int aiCounts[WORD_COUNT];
+   void **ppvValue;
+   char *pcValue;
+   int iInserted;
+   int iSuccessful;
+   int iNumCounts = 0;
+   int i;
+   char acShortstop[] = "Shortstop";
+   char acCenterField[] = "Center Field";
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_upsert() and SymTable_findOrInsert().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* Upserting a new key adds it. */
+   iSuccessful = SymTable_upsert(oSymTable, "Jeter", acCenterField);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_getLength(oSymTable) == 1);
+   ASSURE(SymTable_get(oSymTable, "Jeter") == acCenterField);
+
+   /* Upserting an existing key replaces its value. */
+   iSuccessful = SymTable_upsert(oSymTable, "Jeter", acShortstop);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_getLength(oSymTable) == 1);
+   ASSURE(SymTable_get(oSymTable, "Jeter") == acShortstop);
+
+   /* SymTable_findOrInsert() finds an existing binding and leaves
+      its value alone. */
+   ppvValue = SymTable_findOrInsert(oSymTable, "Jeter", acCenterField,
+      &iInserted);
+   ASSURE(ppvValue != NULL);
+   ASSURE(! iInserted);
+   ASSURE(*ppvValue == acShortstop);
+
+   /* The returned address updates the binding in place. */
+   *ppvValue = acCenterField;
+   ASSURE(SymTable_get(oSymTable, "Jeter") == acCenterField);
+
+   pcValue = (char*)SymTable_remove(oSymTable, "Jeter");
+   ASSURE(pcValue == acCenterField);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+
+   /* Count words with one lookup each. Each value points to the
+      word's counter in aiCounts. */
+   for (i = 0; i < WORD_COUNT; i++)
+   {
+      ppvValue = SymTable_findOrInsert(oSymTable, apcWords[i],
+         &aiCounts[iNumCounts], NULL);
+      ASSURE(ppvValue != NULL);
+      if (*ppvValue == &aiCounts[iNumCounts])
+         aiCounts[iNumCounts++] = 0;
+      (*(int*)*ppvValue)++;
+   }
+   ASSURE(iNumCounts == 4);
+   ASSURE(SymTable_getLength(oSymTable) == 4);
+   ASSURE(*(int*)SymTable_get(oSymTable, "Ruth") == 3);
+   ASSURE(*(int*)SymTable_get(oSymTable, "Gehrig") == 2);
+   ASSURE(*(int*)SymTable_get(oSymTable, "Mantle") == 1);
+   ASSURE(*(int*)SymTable_get(oSymTable, "Jeter") == 1);
+
+   /* A NULL value is stored like any other. */
+   ppvValue = SymTable_findOrInsert(oSymTable, "Maris", NULL,
+      &iInserted);
+   ASSURE(ppvValue != NULL);
+   ASSURE(iInserted);
+   ASSURE(*ppvValue == NULL);
+   ASSURE(SymTable_contains(oSymTable, "Maris"));
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
 /* Test the ability of a SymTable object to contain long keys. */
 
 static void testLongKey(void)
@@ -724,7 +812,9 @@ static void testCollisions(void)
    ASSURE(oSymTable != NULL);
 
    /* Note that strings "250", "469", "947", "1303", and "2016" hash
-      to the same bucket -- bucket 123. */
+      to the same bucket -- bucket 123 -- under the hash function from
+      the assignment specification. A table with a seeded hash
+      function spreads them out, but must still pass this test. */
 
    iSuccessful = SymTable_put(oSymTable, "250", acCenterField);
    ASSURE(iSuccessful);
@@ -917,6 +1007,150 @@ static void testLargeTable(int iBindingCount)
 
 /*--------------------------------------------------------------------*/
 
+/* Measure how long it takes to allocate iBindingCount bindings, to
+   recycle half of them through SymTable_remove() and SymTable_put(),
+   and to tear down the whole SymTable object with SymTable_free().
+   Write the times consumed to stdout. */
+
+static void testAllocationAndTeardown(int iBindingCount)
+{
+   /* room for any int, such as "-2147483648", and its '\0' */
+   enum {MAX_KEY_LENGTH = 12};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   char *pcValue;
+   int i;
+   int iSuccessful;
+   size_t uLength;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing allocation and teardown of a potentially large\n");
+   printf("SymTable object.\n");
+   printf("No output except CPU time consumed should appear here:\n");
+   fflush(stdout);
+
+   /* Put iBindingCount new bindings into oSymTable. */
+   iInitialClock = clock();
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acValue);
+      ASSURE(iSuccessful);
+   }
+   iFinalClock = clock();
+   printf("CPU time (%d bindings allocated):  %f seconds\n",
+      iBindingCount,
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+
+   /* Remove every other binding, then put it back. */
+   iInitialClock = clock();
+   for (i = 0; i < iBindingCount; i += 2)
+   {
+      sprintf(acKey, "%d", i);
+      pcValue = (char*)SymTable_remove(oSymTable, acKey);
+      ASSURE(pcValue == acValue);
+   }
+   for (i = 0; i < iBindingCount; i += 2)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acValue);
+      ASSURE(iSuccessful);
+   }
+   iFinalClock = clock();
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == (size_t)iBindingCount);
+   printf("CPU time (%d bindings recycled):  %f seconds\n",
+      (iBindingCount + 1) / 2,
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+
+   /* Free oSymTable and everything in it. */
+   iInitialClock = clock();
+   SymTable_free(oSymTable);
+   iFinalClock = clock();
+   printf("CPU time (%d bindings freed):  %f seconds\n",
+      iBindingCount,
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+   fflush(stdout);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure how long iLookupCount lookups in a small SymTable object
+   take when a few keys are looked up far more often than the rest, as
+   in the symbol table of a single function. The bindings' popularity
+   follows Zipf's law, and the most popular ones are put first. Write
+   the time consumed to stdout. */
+
+static void testSkewedLookups(int iLookupCount)
+{
+   enum {BINDING_COUNT = 256, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   char acKeys[BINDING_COUNT][MAX_KEY_LENGTH];
+   double adCumulative[BINDING_COUNT];
+   double dTotal;
+   double dDraw;
+   char *pcValue;
+   int i;
+   int iLow;
+   int iHigh;
+   int iSuccessful;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing skewed lookups in a small SymTable object.\n");
+   printf("No output except CPU time consumed should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* Binding i is looked up in proportion to 1/(i+1). */
+   dTotal = 0.0;
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKeys[i], "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKeys[i], acKeys[i]);
+      ASSURE(iSuccessful);
+      dTotal += 1.0 / (i + 1);
+      adCumulative[i] = dTotal;
+   }
+
+   srand(1);
+   iInitialClock = clock();
+   for (i = 0; i < iLookupCount; i++)
+   {
+      /* Pick a binding by binary search of the cumulative weights. */
+      dDraw = dTotal * rand() / ((double)RAND_MAX + 1.0);
+      iLow = 0;
+      iHigh = BINDING_COUNT - 1;
+      while (iLow < iHigh)
+      {
+         if (adCumulative[(iLow + iHigh) / 2] <= dDraw)
+            iLow = (iLow + iHigh) / 2 + 1;
+         else
+            iHigh = (iLow + iHigh) / 2;
+      }
+      pcValue = (char*)SymTable_get(oSymTable, acKeys[iLow]);
+      ASSURE(pcValue == acKeys[iLow]);
+   }
+   iFinalClock = clock();
+   printf("CPU time (%d skewed lookups):  %f seconds\n",
+      iLookupCount,
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
 /* Test the SymTable ADT.  Write the output of the tests to stdout.
    As always, argc is the command-line argument count, argv contains
    the command-line arguments, and argv[0] is the name of the
@@ -957,10 +1191,13 @@ int main(int argc, char *argv[])
    testEmptyTable();
    testEmptyKey();
    testNullValue();
+   testUpsert();
    testLongKey();
    testTableOfTables();
    testCollisions();
    testLargeTable(iBindingCount);
+   testAllocationAndTeardown(iBindingCount);
+   testSkewedLookups(iBindingCount);
 
    printf("------------------------------------------------------\n");
    printf("End of %s.\n", argv[0]);
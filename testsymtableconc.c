@@ -0,0 +1,357 @@
+/*--------------------------------------------------------------------*/
+/* testsymtableconc.c                                                 */
+/* Author: Angel Chang Liu                                            */
+/*--------------------------------------------------------------------*/
+
+/* clock_gettime() is a POSIX feature beyond plain C99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include "symtable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+
+/* Tests of a SymTable implementation that is safe to use from several
+   threads at once, such as symtableconc.c or symtableepoch.c, and a
+   benchmark of its throughput as the number of threads grows. */
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the elapsed wall clock time in seconds since some fixed
+   point. Unlike clock(), this does not add up the time of all of
+   the threads. */
+
+static double getWallTime(void)
+{
+   struct timespec sTime;
+
+   clock_gettime(CLOCK_MONOTONIC, &sTime);
+   return (double)sTime.tv_sec + (double)sTime.tv_nsec / 1e9;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The work of one thread of a test or benchmark */
+
+struct Worker
+{
+   /* The table that all threads share */
+   SymTable_T oSymTable;
+   /* This thread's keys are the decimal numbers iFirst to iLast-1 */
+   int iFirst;
+   int iLast;
+   /* Number of operations to run, for the benchmark */
+   int iOpCount;
+   /* Of every 1000 operations, how many are puts or removes rather
+      than gets, for the benchmark */
+   int iWritesPerThousand;
+   /* Seed of this thread's random numbers, for the benchmark */
+   unsigned long ulSeed;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Put the bindings of the keys of the struct Worker pvWorker into its
+   table, each bound to its own key, then remove the odd ones. Return
+   NULL. */
+
+static void *putAndRemove(void *pvWorker)
+{
+   enum {MAX_KEY_LENGTH = 12};
+
+   struct Worker *psWorker = (struct Worker*)pvWorker;
+   char acKey[MAX_KEY_LENGTH];
+   char *pcValue;
+   int iSuccessful;
+   int i;
+
+   for (i = psWorker->iFirst; i < psWorker->iLast; i++)
+   {
+      sprintf(acKey, "%d", i);
+      pcValue = (char*)malloc(strlen(acKey) + 1);
+      ASSURE(pcValue != NULL);
+      strcpy(pcValue, acKey);
+      iSuccessful = SymTable_put(psWorker->oSymTable, acKey, pcValue);
+      ASSURE(iSuccessful);
+   }
+
+   for (i = psWorker->iFirst; i < psWorker->iLast; i++)
+   {
+      if (i % 2 == 0)
+         continue;
+      sprintf(acKey, "%d", i);
+      pcValue = (char*)SymTable_remove(psWorker->oSymTable, acKey);
+      ASSURE(pcValue != NULL && strcmp(pcValue, acKey) == 0);
+      free(pcValue);
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free pvValue. */
+
+static void freeValue(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvExtra == NULL);
+
+   free(pvValue);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test iThreadCount threads putting and removing iBindingCount
+   bindings in all at once, each with keys of its own, and check
+   that the table ends up holding exactly the bindings that were not
+   removed. */
+
+static void testConcurrentPuts(int iBindingCount, int iThreadCount)
+{
+   enum {MAX_KEY_LENGTH = 12};
+
+   SymTable_T oSymTable;
+   struct Worker *psWorkers;
+   pthread_t *aThreads;
+   char acKey[MAX_KEY_LENGTH];
+   char *pcValue;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing %d threads changing a SymTable object at once.\n",
+      iThreadCount);
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   psWorkers = (struct Worker*)malloc((size_t)iThreadCount *
+      sizeof(struct Worker));
+   ASSURE(psWorkers != NULL);
+   aThreads = (pthread_t*)malloc((size_t)iThreadCount *
+      sizeof(pthread_t));
+   ASSURE(aThreads != NULL);
+
+   for (i = 0; i < iThreadCount; i++)
+   {
+      psWorkers[i].oSymTable = oSymTable;
+      psWorkers[i].iFirst = (int)((long)iBindingCount * i /
+         iThreadCount);
+      psWorkers[i].iLast = (int)((long)iBindingCount * (i + 1) /
+         iThreadCount);
+      iSuccessful = pthread_create(&aThreads[i], NULL, putAndRemove,
+         &psWorkers[i]) == 0;
+      ASSURE(iSuccessful);
+   }
+   for (i = 0; i < iThreadCount; i++)
+      pthread_join(aThreads[i], NULL);
+
+   ASSURE(SymTable_getLength(oSymTable) ==
+      (size_t)(iBindingCount + 1) / 2);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      pcValue = (char*)SymTable_get(oSymTable, acKey);
+      if (i % 2 == 0)
+         ASSURE(pcValue != NULL && strcmp(pcValue, acKey) == 0);
+      else
+         ASSURE(pcValue == NULL);
+   }
+
+   SymTable_map(oSymTable, freeValue, NULL);
+   SymTable_free(oSymTable);
+   free(aThreads);
+   free(psWorkers);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Run the operations of the benchmark thread pvWorker, a struct
+   Worker, on random keys of its table: gets, except for the given
+   share of writes, half of them puts and half removes. Return
+   NULL. */
+
+static void *runMix(void *pvWorker)
+{
+   enum {MAX_KEY_LENGTH = 12};
+
+   struct Worker *psWorker = (struct Worker*)pvWorker;
+   char acKey[MAX_KEY_LENGTH];
+   unsigned long ulRandom = psWorker->ulSeed;
+   unsigned long ulChoice;
+   int i;
+
+   for (i = 0; i < psWorker->iOpCount; i++)
+   {
+      /* a small generator of its own, since rand() is not safe to
+         call from several threads */
+      ulRandom = (ulRandom * 1103515245UL + 12345UL) & 0x7fffffffUL;
+      ulChoice = ulRandom % 1000;
+      sprintf(acKey, "%lu", (ulRandom >> 7) %
+         (unsigned long)(psWorker->iLast - psWorker->iFirst));
+
+      if (ulChoice >= (unsigned long)psWorker->iWritesPerThousand)
+         (void)SymTable_get(psWorker->oSymTable, acKey);
+      else if (ulChoice % 2 == 0)
+         (void)SymTable_put(psWorker->oSymTable, acKey, "value");
+      else
+         (void)SymTable_remove(psWorker->oSymTable, acKey);
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure the throughput of a table of about iBindingCount bindings
+   under a mix of operations, iWritesPerThousand in 1000 of them puts
+   or removes and the rest gets, run by 1, 2, 4, ... up to
+   iThreadCount threads at once. Each thread runs the same number of
+   operations, so ideal scaling keeps the time constant. */
+
+static void testThroughput(int iBindingCount, int iThreadCount,
+   int iWritesPerThousand)
+{
+   enum {OPS_PER_THREAD = 1000000, MAX_KEY_LENGTH = 12};
+
+   SymTable_T oSymTable;
+   struct Worker *psWorkers;
+   pthread_t *aThreads;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   double dStart;
+   double dTime;
+   int iThreads;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Measuring throughput with 1 to %d threads, "
+      "%.1f%% writes.\n", iThreadCount, iWritesPerThousand / 10.0);
+   printf("No output except throughput should appear here:\n");
+   fflush(stdout);
+
+   /* the keys range over twice the bindings, so about half of the
+      gets find a binding */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < iBindingCount; i += 2)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acValue);
+      ASSURE(iSuccessful);
+   }
+
+   psWorkers = (struct Worker*)malloc((size_t)iThreadCount *
+      sizeof(struct Worker));
+   ASSURE(psWorkers != NULL);
+   aThreads = (pthread_t*)malloc((size_t)iThreadCount *
+      sizeof(pthread_t));
+   ASSURE(aThreads != NULL);
+
+   iThreads = 1;
+   for (;;)
+   {
+      dStart = getWallTime();
+      for (i = 0; i < iThreads; i++)
+      {
+         psWorkers[i].oSymTable = oSymTable;
+         psWorkers[i].iFirst = 0;
+         psWorkers[i].iLast = iBindingCount > 0 ? iBindingCount : 1;
+         psWorkers[i].iOpCount = OPS_PER_THREAD;
+         psWorkers[i].iWritesPerThousand = iWritesPerThousand;
+         psWorkers[i].ulSeed = (unsigned long)i * 7919UL + 1UL;
+         iSuccessful = pthread_create(&aThreads[i], NULL, runMix,
+            &psWorkers[i]) == 0;
+         ASSURE(iSuccessful);
+      }
+      for (i = 0; i < iThreads; i++)
+         pthread_join(aThreads[i], NULL);
+      dTime = getWallTime() - dStart;
+
+      printf("%3d threads: %8.2f million operations per second\n",
+         iThreads, (double)iThreads * OPS_PER_THREAD / dTime / 1e6);
+      fflush(stdout);
+
+      /* double the threads, ending with iThreadCount itself even if
+         it is not a power of 2 */
+      if (iThreads == iThreadCount)
+         break;
+      iThreads = iThreads * 2 < iThreadCount ? iThreads * 2 :
+         iThreadCount;
+   }
+
+   SymTable_free(oSymTable);
+   free(aThreads);
+   free(psWorkers);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test a thread-safe SymTable implementation with argv[1] bindings
+   and up to argv[2] threads. As always, return 0. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+   int iThreadCount;
+
+   if (argc != 3)
+   {
+      fprintf(stderr, "Usage: %s bindingcount threadcount\n",
+         argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1)
+   {
+      fprintf(stderr, "bindingcount must be numeric\n");
+      exit(EXIT_FAILURE);
+   }
+   if (iBindingCount < 0)
+   {
+      fprintf(stderr, "bindingcount cannot be negative\n");
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[2], "%d", &iThreadCount) != 1)
+   {
+      fprintf(stderr, "threadcount must be numeric\n");
+      exit(EXIT_FAILURE);
+   }
+   if (iThreadCount < 1)
+   {
+      fprintf(stderr, "threadcount must be at least 1\n");
+      exit(EXIT_FAILURE);
+   }
+
+   testConcurrentPuts(iBindingCount, iThreadCount);
+   testThroughput(iBindingCount, iThreadCount, 100);
+   testThroughput(iBindingCount, iThreadCount, 1);
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}
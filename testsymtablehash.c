@@ -0,0 +1,1148 @@
+/*--------------------------------------------------------------------*/
+/* testsymtablehash.c                                                 */
+/* Author: Angel Chang Liu                                            */
+/*--------------------------------------------------------------------*/
+
+#include "symtablehash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <assert.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return a hash code for pcKey that ignores the case of its
+   letters. */
+
+static size_t hashIgnoringCase(const char *pcKey)
+{
+   size_t uHash = 0;
+
+   assert(pcKey != NULL);
+
+   for (; *pcKey != '\0'; pcKey++)
+      uHash = uHash * 31 + (size_t)tolower((unsigned char)*pcKey);
+   return uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return 1 (TRUE) if pcKey1 and pcKey2 are equal ignoring the case
+   of their letters, and 0 (FALSE) otherwise. */
+
+static int equalIgnoringCase(const char *pcKey1, const char *pcKey2)
+{
+   assert(pcKey1 != NULL);
+   assert(pcKey2 != NULL);
+
+   for (; *pcKey1 != '\0'; pcKey1++, pcKey2++)
+      if (tolower((unsigned char)*pcKey1) !=
+         tolower((unsigned char)*pcKey2))
+         return 0;
+   return *pcKey2 == '\0';
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the decimal number pcKey as a hash code. Every hash code
+   is small, so the table must spread them itself. */
+
+static size_t hashNumber(const char *pcKey)
+{
+   assert(pcKey != NULL);
+
+   return (size_t)strtoul(pcKey, NULL, 10);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Count a binding by incrementing the int that pvValue points to.
+   Each binding has its own int, so several threads may do this at
+   once for distinct bindings. */
+
+static void countBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvValue != NULL);
+   assert(pvExtra == NULL);
+
+   (*(int*)pvValue)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Store the string pvValue, with its '\0', in the uSize bytes at
+   pvBuffer if it fits. Return its size. */
+
+static size_t saveString(const void *pvValue, void *pvBuffer,
+   size_t uSize)
+{
+   size_t uLength;
+
+   assert(pvValue != NULL);
+
+   uLength = strlen((const char*)pvValue) + 1;
+   if (uLength <= uSize)
+      memcpy(pvBuffer, pvValue, uLength);
+   return uLength;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Store in *ppvValue a new copy of the string of uSize bytes at
+   pvBytes. Return 1 (TRUE) on success, or 0 (FALSE) if memory is
+   insufficient. */
+
+static int loadString(const void *pvBytes, size_t uSize,
+   void **ppvValue)
+{
+   assert(pvBytes != NULL);
+   assert(ppvValue != NULL);
+
+   *ppvValue = malloc(uSize);
+   if (*ppvValue == NULL)
+      return 0;
+   memcpy(*ppvValue, pvBytes, uSize);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Store the bits of the pointer pvValue, which holds a number rather
+   than an address, in the uSize bytes at pvBuffer if they fit.
+   Return their size. */
+
+static size_t saveNumber(const void *pvValue, void *pvBuffer,
+   size_t uSize)
+{
+   if (sizeof(pvValue) <= uSize)
+      memcpy(pvBuffer, &pvValue, sizeof(pvValue));
+   return sizeof(pvValue);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Store in *ppvValue the pointer that saveNumber() stored in the
+   uSize bytes at pvBytes. Return 1 (TRUE) on success, or 0 (FALSE)
+   if uSize is wrong. */
+
+static int loadNumber(const void *pvBytes, size_t uSize,
+   void **ppvValue)
+{
+   assert(pvBytes != NULL);
+   assert(ppvValue != NULL);
+
+   if (uSize != sizeof(*ppvValue))
+      return 0;
+   memcpy(ppvValue, pvBytes, uSize);
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Number of values that freeLoadedValue() has freed */
+
+static int iNumFreedValues = 0;
+
+/* Free pvValue, a value that SymTable_load() gives back, and count
+   it in iNumFreedValues. */
+
+static void freeLoadedValue(void *pvValue)
+{
+   free(pvValue);
+   iNumFreedValues++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Free pvValue. */
+
+static void freeValue(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvExtra == NULL);
+
+   free(pvValue);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_newWithOps() with caller-supplied hash and
+   comparison functions. */
+
+static void testOps(void)
+{
+   enum {BINDING_COUNT = 20000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   char acShortstop[] = "Shortstop";
+   char acCenterField[] = "Center Field";
+   char acKey[MAX_KEY_LENGTH];
+   char *pcValue;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_newWithOps().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* Keys that differ only in case are the same key. */
+   oSymTable = SymTable_newWithOps(hashIgnoringCase, equalIgnoringCase);
+   ASSURE(oSymTable != NULL);
+   iSuccessful = SymTable_put(oSymTable, "Jeter", acShortstop);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, "JETER", acCenterField);
+   ASSURE(! iSuccessful);
+   pcValue = (char*)SymTable_get(oSymTable, "jeter");
+   ASSURE(pcValue == acShortstop);
+   pcValue = (char*)SymTable_replace(oSymTable, "jEtEr", acCenterField);
+   ASSURE(pcValue == acShortstop);
+   ASSURE(SymTable_contains(oSymTable, "JeTeR"));
+   pcValue = (char*)SymTable_remove(oSymTable, "JETER");
+   ASSURE(pcValue == acCenterField);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   SymTable_free(oSymTable);
+
+   /* A hash function with no spread still works as the table grows;
+      only the default comparison is used. */
+   oSymTable = SymTable_newWithOps(hashNumber, NULL);
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acShortstop);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == BINDING_COUNT);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      pcValue = (char*)SymTable_get(oSymTable, acKey);
+      ASSURE(pcValue == acShortstop);
+   }
+   pcValue = (char*)SymTable_get(oSymTable, "007");
+   ASSURE(pcValue == NULL);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_prehash() and the functions that take hashed keys,
+   including across expansions of the table and with a second table
+   loaded from a snapshot of the first. */
+
+static void testPrehash(void)
+{
+   enum {BINDING_COUNT = 20000, MAX_KEY_LENGTH = 10};
+
+   const char *pcPath = "testsymtablehash.snapshot";
+   SymTable_T oSymTable;
+   SymTable_T oLoaded;
+   struct SymTableHashedKey sJeter;
+   struct SymTableHashedKey sRuth;
+   char acShortstop[] = "Shortstop";
+   char acRightField[] = "Right Field";
+   char acKey[MAX_KEY_LENGTH];
+   char *pcValue;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_prehash().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   sJeter = SymTable_prehash(oSymTable, "Jeter");
+   sRuth = SymTable_prehash(oSymTable, "Ruth");
+
+   iSuccessful = SymTable_putHashed(oSymTable, sJeter, acShortstop);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putHashed(oSymTable, sJeter, acRightField);
+   ASSURE(! iSuccessful);
+   ASSURE(SymTable_containsHashed(oSymTable, sJeter));
+   ASSURE(! SymTable_containsHashed(oSymTable, sRuth));
+   ASSURE(SymTable_get(oSymTable, "Jeter") == acShortstop);
+
+   /* Hashed keys stay valid as the table grows. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acRightField);
+      ASSURE(iSuccessful);
+      pcValue = (char*)SymTable_getHashed(oSymTable, sJeter);
+      ASSURE(pcValue == acShortstop);
+   }
+
+   iSuccessful = SymTable_put(oSymTable, "Ruth", acRightField);
+   ASSURE(iSuccessful);
+   pcValue = (char*)SymTable_replaceHashed(oSymTable, sRuth,
+      acShortstop);
+   ASSURE(pcValue == acRightField);
+   pcValue = (char*)SymTable_removeHashed(oSymTable, sRuth);
+   ASSURE(pcValue == acShortstop);
+   pcValue = (char*)SymTable_removeHashed(oSymTable, sRuth);
+   ASSURE(pcValue == NULL);
+   ASSURE(SymTable_getLength(oSymTable) == BINDING_COUNT + 1);
+
+   /* A loaded snapshot keeps the seed, so the same hashed keys work
+      with it too, and find and add bindings just as its keys do. */
+   ASSURE(SymTable_save(oSymTable, pcPath, saveString));
+   oLoaded = SymTable_load(pcPath, loadString, free);
+   ASSURE(oLoaded != NULL);
+   remove(pcPath);
+   pcValue = (char*)SymTable_getHashed(oLoaded, sJeter);
+   ASSURE((pcValue != NULL) && (strcmp(pcValue, acShortstop) == 0));
+   ASSURE(! SymTable_putHashed(oLoaded, sJeter, NULL));
+   ASSURE(! SymTable_containsHashed(oLoaded, sRuth));
+   ASSURE(SymTable_putHashed(oLoaded, sRuth, NULL));
+   ASSURE(SymTable_contains(oLoaded, "Ruth"));
+   ASSURE(SymTable_getLength(oLoaded) == BINDING_COUNT + 2);
+   ASSURE(! SymTable_containsHashed(oSymTable, sRuth));
+   SymTable_map(oLoaded, freeValue, NULL);
+   SymTable_free(oLoaded);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_getMany() against SymTable_get(), with present and
+   absent keys, NULL values and batches of assorted sizes. */
+
+static void testGetMany(void)
+{
+   enum {BINDING_COUNT = 5000, KEY_COUNT = 300, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   char aacKeys[KEY_COUNT][MAX_KEY_LENGTH];
+   const char *apcKeys[KEY_COUNT];
+   void *apvValues[KEY_COUNT];
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   size_t uFound;
+   size_t uExpected;
+   size_t uCount;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_getMany().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* Even numbers are bound; multiples of 10 are bound to NULL. */
+   for (i = 0; i < BINDING_COUNT; i += 2)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey,
+         (i % 10 == 0) ? NULL : acValue);
+      ASSURE(iSuccessful);
+   }
+
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(aacKeys[i], "%d", (i * 7919) % (BINDING_COUNT + 100));
+      apcKeys[i] = aacKeys[i];
+   }
+
+   for (uCount = 0; uCount <= KEY_COUNT; uCount += 37)
+   {
+      uFound = SymTable_getMany(oSymTable, apcKeys, uCount, apvValues);
+      uExpected = 0;
+      for (i = 0; i < (int)uCount; i++)
+      {
+         ASSURE(apvValues[i] == SymTable_get(oSymTable, apcKeys[i]));
+         if (SymTable_contains(oSymTable, apcKeys[i]))
+            uExpected++;
+      }
+      ASSURE(uFound == uExpected);
+   }
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_putMany(), including keys already in the table and
+   keys repeated within a batch. Write the time consumed by a bulk
+   load of iBindingCount bindings, and by the same load through
+   SymTable_put(), to stdout. */
+
+static void testPutMany(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 12};
+
+   SymTable_T oSymTable;
+   const char *apcKeys[] = {"Jeter", "Mantle", "Jeter", "Ruth"};
+   const void *apvValues[] = {"Shortstop", "Center Field",
+      "Catcher", "Right Field"};
+   int aiResults[4];
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   const char **ppcKeys;
+   const void **ppvValues;
+   size_t uPut;
+   int i;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_putMany().\n");
+   printf("No output except CPU time consumed should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_put(oSymTable, "Mantle", "First Base"));
+   uPut = SymTable_putMany(oSymTable, apcKeys, apvValues, 4, aiResults);
+   ASSURE(uPut == 2);
+   ASSURE(aiResults[0] && ! aiResults[1] && ! aiResults[2] &&
+      aiResults[3]);
+   ASSURE(SymTable_getLength(oSymTable) == 3);
+   ASSURE(strcmp((char*)SymTable_get(oSymTable, "Jeter"),
+      "Shortstop") == 0);
+   ASSURE(strcmp((char*)SymTable_get(oSymTable, "Mantle"),
+      "First Base") == 0);
+   SymTable_free(oSymTable);
+
+   pacKeys = malloc((size_t)iBindingCount * sizeof(*pacKeys));
+   ppcKeys = malloc((size_t)iBindingCount * sizeof(*ppcKeys));
+   ppvValues = malloc((size_t)iBindingCount * sizeof(*ppvValues));
+   ASSURE(pacKeys != NULL && ppcKeys != NULL && ppvValues != NULL);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(pacKeys[i], "%d", i);
+      ppcKeys[i] = pacKeys[i];
+      ppvValues[i] = pacKeys[i];
+   }
+
+   iInitialClock = clock();
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < iBindingCount; i++)
+      ASSURE(SymTable_put(oSymTable, ppcKeys[i], ppvValues[i]));
+   SymTable_free(oSymTable);
+   iFinalClock = clock();
+   printf("CPU time (%d bindings put):  %f seconds\n", iBindingCount,
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+
+   iInitialClock = clock();
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   uPut = SymTable_putMany(oSymTable, ppcKeys, ppvValues,
+      (size_t)iBindingCount, NULL);
+   ASSURE(uPut == (size_t)iBindingCount);
+   iFinalClock = clock();
+   for (i = 0; i < iBindingCount; i++)
+      ASSURE(SymTable_get(oSymTable, ppcKeys[i]) == ppvValues[i]);
+   SymTable_free(oSymTable);
+   printf("CPU time (%d bindings bulk put):  %f seconds\n",
+      iBindingCount,
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+   fflush(stdout);
+
+   free(pacKeys);
+   free(ppcKeys);
+   free(ppvValues);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_iterBegin() and SymTable_iterNext(), on a sparse
+   table, on a table in the middle of growing, with bindings removed
+   during the enumeration and with an enumeration that stops early. */
+
+static void testIter(void)
+{
+   /* The table grows from 251 to 509 buckets and then to 1021 when
+      the 510th binding is put, so the last few puts leave most of
+      the bindings still to be moved. */
+   enum {BINDING_COUNT = 520, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   struct SymTableIter sIter;
+   int aiSeen[BINDING_COUNT];
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   char acTarget[] = "target";
+   const char *pcKey;
+   void *pvValue;
+   int iCount;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_iterBegin() and SymTable_iterNext().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* An empty table has nothing to enumerate. */
+   SymTable_iterBegin(oSymTable, &sIter);
+   ASSURE(! SymTable_iterNext(&sIter, &pcKey, &pvValue));
+   ASSURE(! SymTable_iterNext(&sIter, &pcKey, &pvValue));
+
+   /* A sparse table yields each binding once. */
+   iSuccessful = SymTable_put(oSymTable, "Ruth", acValue);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, "Gehrig", acValue);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, "Mantle", acTarget);
+   ASSURE(iSuccessful);
+   iCount = 0;
+   SymTable_iterBegin(oSymTable, &sIter);
+   while (SymTable_iterNext(&sIter, &pcKey, &pvValue))
+   {
+      ASSURE(SymTable_get(oSymTable, pcKey) == pvValue);
+      iCount++;
+   }
+   ASSURE(iCount == 3);
+
+   /* A search can stop at the first match. */
+   iCount = 0;
+   SymTable_iterBegin(oSymTable, &sIter);
+   while (SymTable_iterNext(&sIter, &pcKey, &pvValue))
+   {
+      iCount++;
+      if (pvValue == acTarget)
+         break;
+   }
+   ASSURE(pvValue == acTarget);
+   ASSURE(strcmp(pcKey, "Mantle") == 0);
+   ASSURE(iCount <= 3);
+   SymTable_free(oSymTable);
+
+   /* A table that has just grown yields each binding once. */
+   oSymTable = SymTable_newWithCapacity(0);
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acValue);
+      ASSURE(iSuccessful);
+      aiSeen[i] = 0;
+   }
+   SymTable_iterBegin(oSymTable, &sIter);
+   while (SymTable_iterNext(&sIter, &pcKey, NULL))
+   {
+      i = atoi(pcKey);
+      ASSURE(i >= 0 && i < BINDING_COUNT);
+      aiSeen[i]++;
+      /* Removing the binding just returned is allowed. */
+      if (i % 2 == 1)
+         ASSURE(SymTable_remove(oSymTable, pcKey) == acValue);
+   }
+   for (i = 0; i < BINDING_COUNT; i++)
+      ASSURE(aiSeen[i] == 1);
+   ASSURE(SymTable_getLength(oSymTable) == BINDING_COUNT / 2);
+
+   /* The removed bindings are gone from later enumerations. */
+   iCount = 0;
+   SymTable_iterBegin(oSymTable, &sIter);
+   while (SymTable_iterNext(&sIter, NULL, &pvValue))
+   {
+      ASSURE(pvValue == acValue);
+      iCount++;
+   }
+   ASSURE(iCount == BINDING_COUNT / 2);
+   ASSURE(! SymTable_contains(oSymTable, "519"));
+   ASSURE(SymTable_contains(oSymTable, "518"));
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_newWithCapacity() and SymTable_reserve(), with tables
+   that outgrow their capacity hints and tables that never reach
+   them. */
+
+static void testCapacity(void)
+{
+   enum {BINDING_COUNT = 5000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   char acValue[] = "value";
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_newWithCapacity() and SymTable_reserve().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* A tiny table still grows as needed. */
+   oSymTable = SymTable_newWithCapacity(0);
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acValue);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == BINDING_COUNT);
+   ASSURE(SymTable_get(oSymTable, "4999") == acValue);
+   SymTable_free(oSymTable);
+
+   /* Reserving room in a table that holds bindings keeps them. */
+   oSymTable = SymTable_newWithCapacity(BINDING_COUNT);
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, acValue);
+      ASSURE(iSuccessful);
+   }
+   iSuccessful = SymTable_reserve(oSymTable, 20 * BINDING_COUNT);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_reserve(oSymTable, 1);
+   ASSURE(iSuccessful);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_get(oSymTable, acKey) == acValue);
+   }
+   ASSURE(SymTable_remove(oSymTable, "0") == acValue);
+   ASSURE(SymTable_getLength(oSymTable) == BINDING_COUNT - 1);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_mapParallel() with various numbers of threads, on a
+   table of iBindingCount bindings and on a table in the middle of
+   growing. Each binding must be visited exactly once. */
+
+static void testMapParallel(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 12, GROWING_COUNT = 520};
+
+   SymTable_T oSymTable;
+   int *piCounts;
+   char acKey[MAX_KEY_LENGTH];
+   size_t auThreads[] = {0, 1, 2, 8, 1000};
+   size_t t;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_mapParallel().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   piCounts = (int*)calloc((size_t)iBindingCount + GROWING_COUNT,
+      sizeof(int));
+   ASSURE(piCounts != NULL);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, &piCounts[i]);
+      ASSURE(iSuccessful);
+   }
+   for (t = 0; t < sizeof(auThreads) / sizeof(auThreads[0]); t++)
+   {
+      SymTable_mapParallel(oSymTable, countBinding, NULL,
+         auThreads[t]);
+      for (i = 0; i < iBindingCount; i++)
+         ASSURE(piCounts[i] == (int)t + 1);
+   }
+   SymTable_free(oSymTable);
+
+   /* As in testIter, the last few puts leave most bindings still in
+      the old bucket array. */
+   oSymTable = SymTable_newWithCapacity(0);
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < GROWING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey,
+         &piCounts[iBindingCount + i]);
+      ASSURE(iSuccessful);
+   }
+   SymTable_mapParallel(oSymTable, countBinding, NULL, 4);
+   for (i = 0; i < GROWING_COUNT; i++)
+      ASSURE(piCounts[iBindingCount + i] == 1);
+   SymTable_free(oSymTable);
+
+   free(piCounts);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_intern() and tables made by SymTable_newForAtoms(),
+   whose keys are compared by address. */
+
+static void testAtoms(void)
+{
+   enum {BINDING_COUNT = 2000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oInterner;
+   SymTable_T oSymTable;
+   SymTable_T oSymTable2;
+   struct SymTableIter sIter;
+   const char *pcAtom;
+   const char *pcAtom2;
+   const char *pcKey;
+   char acKey[MAX_KEY_LENGTH];
+   char acShortstop[] = "Shortstop";
+   char acCenterField[] = "Center Field";
+   int iSuccessful;
+   int iCount;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_intern() and SymTable_newForAtoms().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oInterner = SymTable_new();
+   ASSURE(oInterner != NULL);
+
+   /* Equal strings give the same atom, kept by the interner. */
+   strcpy(acKey, "Jeter");
+   pcAtom = SymTable_intern(oInterner, acKey);
+   ASSURE(pcAtom != NULL);
+   ASSURE(pcAtom != acKey);
+   ASSURE(strcmp(pcAtom, "Jeter") == 0);
+   strcpy(acKey, "xxxxx");
+   ASSURE(SymTable_intern(oInterner, "Jeter") == pcAtom);
+   ASSURE(SymTable_getLength(oInterner) == 1);
+   ASSURE(SymTable_get(oInterner, "Jeter") == NULL);
+   pcAtom2 = SymTable_intern(oInterner, "Mantle");
+   ASSURE(pcAtom2 != NULL && pcAtom2 != pcAtom);
+
+   /* Two tables share the interner's atoms. */
+   oSymTable = SymTable_newForAtoms();
+   ASSURE(oSymTable != NULL);
+   oSymTable2 = SymTable_newForAtoms();
+   ASSURE(oSymTable2 != NULL);
+   iSuccessful = SymTable_put(oSymTable, pcAtom, acShortstop);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTable2, pcAtom, acCenterField);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, pcAtom, acCenterField);
+   ASSURE(! iSuccessful);
+   ASSURE(SymTable_get(oSymTable, pcAtom) == acShortstop);
+   ASSURE(SymTable_get(oSymTable2, pcAtom) == acCenterField);
+   ASSURE(! SymTable_contains(oSymTable, pcAtom2));
+
+   /* A string equal to an atom is not the atom. */
+   strcpy(acKey, "Jeter");
+   ASSURE(! SymTable_contains(oSymTable, acKey));
+
+   /* Bindings hand out the atoms themselves as keys. */
+   SymTable_iterBegin(oSymTable, &sIter);
+   ASSURE(SymTable_iterNext(&sIter, &pcKey, NULL));
+   ASSURE(pcKey == pcAtom);
+   ASSURE(! SymTable_iterNext(&sIter, &pcKey, NULL));
+
+   ASSURE(SymTable_remove(oSymTable, pcAtom) == acShortstop);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   SymTable_free(oSymTable2);
+
+   /* Atoms stay put while the interner and the table grow. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      pcAtom = SymTable_intern(oInterner, acKey);
+      ASSURE(pcAtom != NULL);
+      iSuccessful = SymTable_put(oSymTable, pcAtom, acShortstop);
+      ASSURE(iSuccessful);
+   }
+   iCount = 0;
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      pcAtom = SymTable_intern(oInterner, acKey);
+      if (SymTable_get(oSymTable, pcAtom) == acShortstop)
+         iCount++;
+   }
+   ASSURE(iCount == BINDING_COUNT);
+   ASSURE(SymTable_getLength(oInterner) == BINDING_COUNT + 2);
+
+   SymTable_free(oSymTable);
+   SymTable_free(oInterner);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_putBorrowed() and SymTable_putOwned(), whose bindings
+   use the caller's keys instead of copies. */
+
+static void testBorrowedKeys(void)
+{
+   enum {BINDING_COUNT = 2000, MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   struct SymTableIter sIter;
+   const char *pcKey;
+   char *pcOwnedKey;
+   char acKey[MAX_KEY_LENGTH];
+   char acJeter[] = "Jeter";
+   char acShortstop[] = "Shortstop";
+   char acCenterField[] = "Center Field";
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_putBorrowed() and SymTable_putOwned().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* A borrowed key is found by value and handed out as is. */
+   iSuccessful = SymTable_putBorrowed(oSymTable, acJeter, acShortstop);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putBorrowed(oSymTable, "Jeter", acCenterField);
+   ASSURE(! iSuccessful);
+   iSuccessful = SymTable_put(oSymTable, "Jeter", acCenterField);
+   ASSURE(! iSuccessful);
+   ASSURE(SymTable_get(oSymTable, "Jeter") == acShortstop);
+   SymTable_iterBegin(oSymTable, &sIter);
+   ASSURE(SymTable_iterNext(&sIter, &pcKey, NULL));
+   ASSURE(pcKey == acJeter);
+   ASSURE(SymTable_remove(oSymTable, "Jeter") == acShortstop);
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+
+   /* Owned keys are freed by SymTable_remove and SymTable_free, even 
+      while the table grows. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      pcOwnedKey = (char*)malloc(strlen(acKey) + 1);
+      ASSURE(pcOwnedKey != NULL);
+      strcpy(pcOwnedKey, acKey);
+      iSuccessful = SymTable_putOwned(oSymTable, pcOwnedKey, 
+         acShortstop);
+      ASSURE(iSuccessful);
+   }
+   pcOwnedKey = (char*)malloc(strlen("0") + 1);
+   ASSURE(pcOwnedKey != NULL);
+   strcpy(pcOwnedKey, "0");
+   iSuccessful = SymTable_putOwned(oSymTable, pcOwnedKey, acCenterField);
+   ASSURE(! iSuccessful);
+   free(pcOwnedKey);
+
+   iSuccessful = SymTable_putBorrowed(oSymTable, acJeter, acShortstop);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_getLength(oSymTable) == BINDING_COUNT + 1);
+   for (i = 0; i < BINDING_COUNT; i += 2)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_remove(oSymTable, acKey) == acShortstop);
+   }
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_contains(oSymTable, acKey) == (i % 2 != 0));
+   }
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the SymTable_*N() functions, whose keys are slices of a
+   larger buffer, against the functions that take whole strings. */
+
+static void testKeySlices(void)
+{
+   SymTable_T oSymTable;
+   struct SymTableIter sIter;
+   const char *pcKey;
+   const char *pcBuffer = "Jeter Mantle Gehrig Jet";
+   char acShortstop[] = "Shortstop";
+   char acCenterField[] = "Center Field";
+   char acFirstBase[] = "First Base";
+   int iSuccessful;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the SymTable_*N() functions.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* "Jeter", "Mantle", and "Jet", a prefix of "Jeter" */
+   iSuccessful = SymTable_putN(oSymTable, pcBuffer, 5, acShortstop);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putN(oSymTable, pcBuffer + 6, 6,
+      acCenterField);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putN(oSymTable, pcBuffer + 6, 6,
+      acShortstop);
+   ASSURE(! iSuccessful);
+   ASSURE(! SymTable_containsN(oSymTable, pcBuffer + 20, 3));
+   ASSURE(! SymTable_containsN(oSymTable, pcBuffer, 3));
+   iSuccessful = SymTable_putN(oSymTable, pcBuffer + 20, 3,
+      acFirstBase);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_getLength(oSymTable) == 3);
+
+   /* The slices and the whole strings name the same bindings. */
+   ASSURE(SymTable_get(oSymTable, "Jeter") == acShortstop);
+   ASSURE(SymTable_get(oSymTable, "Jet") == acFirstBase);
+   ASSURE(SymTable_getN(oSymTable, pcBuffer, 3) == acFirstBase);
+   ASSURE(SymTable_getN(oSymTable, "Mantlex", 6) == acCenterField);
+   ASSURE(SymTable_getN(oSymTable, pcBuffer + 13, 6) == NULL);
+   ASSURE(SymTable_getN(oSymTable, pcBuffer, 0) == NULL);
+   iSuccessful = SymTable_put(oSymTable, "Mantle", acShortstop);
+   ASSURE(! iSuccessful);
+   ASSURE(SymTable_replaceN(oSymTable, pcBuffer + 6, 6, acFirstBase)
+      == acCenterField);
+   ASSURE(SymTable_get(oSymTable, "Mantle") == acFirstBase);
+
+   /* Stored keys are ended by '\0' like any other. */
+   SymTable_iterBegin(oSymTable, &sIter);
+   while (SymTable_iterNext(&sIter, &pcKey, NULL))
+      ASSURE(strcmp(pcKey, "Jeter") == 0 || strcmp(pcKey, "Mantle") == 0
+         || strcmp(pcKey, "Jet") == 0);
+
+   ASSURE(SymTable_removeN(oSymTable, pcBuffer, 5) == acShortstop);
+   ASSURE(SymTable_removeN(oSymTable, pcBuffer, 5) == NULL);
+   ASSURE(SymTable_contains(oSymTable, "Jet"));
+   ASSURE(SymTable_getLength(oSymTable) == 2);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_save() and SymTable_load(), and compare the time to
+   load a snapshot of iBindingCount bindings with the time to put
+   them. */
+
+static void testSnapshot(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 12, GROWING_COUNT = 520,
+      LONG_KEY_LENGTH = 300, MAX_SNAPSHOT_SIZE = 256};
+
+   const char *pcPath = "testsymtablehash.snapshot";
+   SymTable_T oSymTable;
+   SymTable_T oLoaded;
+   FILE *psFile;
+   char acKey[MAX_KEY_LENGTH];
+   char acLongKey[LONG_KEY_LENGTH + 1];
+   char acSnapshot[MAX_SNAPSHOT_SIZE];
+   size_t uSize;
+   uint64_t uHugeCount;
+   int i;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_save() and SymTable_load().\n");
+   printf("No output except CPU time consumed should appear here:\n");
+   fflush(stdout);
+
+   /* Save a growing table, with a long key, a borrowed key and an
+      empty key. */
+   memset(acLongKey, 'x', LONG_KEY_LENGTH);
+   acLongKey[LONG_KEY_LENGTH] = '\0';
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < GROWING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_put(oSymTable, acKey, "Number"));
+   }
+   ASSURE(SymTable_put(oSymTable, acLongKey, "Long"));
+   ASSURE(SymTable_putBorrowed(oSymTable, "Ruth", "Right Field"));
+   ASSURE(SymTable_put(oSymTable, "", "Empty"));
+   ASSURE(SymTable_save(oSymTable, pcPath, saveString));
+
+   oLoaded = SymTable_load(pcPath, loadString, free);
+   ASSURE(oLoaded != NULL);
+   ASSURE(SymTable_getLength(oLoaded) == SymTable_getLength(oSymTable));
+   for (i = 0; i < GROWING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(strcmp((char*)SymTable_get(oLoaded, acKey), "Number")
+         == 0);
+   }
+   ASSURE(strcmp((char*)SymTable_get(oLoaded, acLongKey), "Long") == 0);
+   ASSURE(strcmp((char*)SymTable_get(oLoaded, "Ruth"),
+      "Right Field") == 0);
+   ASSURE(strcmp((char*)SymTable_get(oLoaded, ""), "Empty") == 0);
+   ASSURE(! SymTable_contains(oLoaded, "Mantle"));
+
+   /* The loaded table works as any other. */
+   ASSURE(! SymTable_put(oLoaded, "Ruth", NULL));
+   ASSURE(SymTable_put(oLoaded, "Mantle", NULL));
+   free(SymTable_remove(oLoaded, "Ruth"));
+   ASSURE(! SymTable_contains(oLoaded, "Ruth"));
+   SymTable_map(oLoaded, freeValue, NULL);
+   SymTable_free(oLoaded);
+   SymTable_free(oSymTable);
+
+   /* An empty table round-trips. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_save(oSymTable, pcPath, saveString));
+   SymTable_free(oSymTable);
+   oLoaded = SymTable_load(pcPath, loadString, free);
+   ASSURE(oLoaded != NULL);
+   ASSURE(SymTable_getLength(oLoaded) == 0);
+   ASSURE(SymTable_put(oLoaded, "Jeter", NULL));
+   SymTable_free(oLoaded);
+
+   /* Missing files, other files, values that *pfLoadValue rejects
+      and snapshots that are cut short fail to load. */
+   ASSURE(SymTable_load("no/such/file", loadString, free) == NULL);
+   psFile = fopen(pcPath, "w");
+   ASSURE(psFile != NULL);
+   fprintf(psFile, "Jeter Shortstop\n");
+   fclose(psFile);
+   ASSURE(SymTable_load(pcPath, loadString, free) == NULL);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   ASSURE(SymTable_put(oSymTable, "Jeter", "Shortstop"));
+   ASSURE(SymTable_put(oSymTable, "Ruth", "Right Field"));
+   ASSURE(SymTable_save(oSymTable, pcPath, saveString));
+   ASSURE(SymTable_load(pcPath, loadNumber, NULL) == NULL);
+   SymTable_free(oSymTable);
+   psFile = fopen(pcPath, "rb");
+   ASSURE(psFile != NULL);
+   uSize = fread(acSnapshot, 1, sizeof(acSnapshot), psFile);
+   fclose(psFile);
+   ASSURE(uSize > 0 && uSize < sizeof(acSnapshot));
+
+   /* The value already made for the first binding is given back
+      when the second is cut short. */
+   psFile = fopen(pcPath, "wb");
+   ASSURE(psFile != NULL);
+   ASSURE(fwrite(acSnapshot, 1, uSize - 1, psFile) == uSize - 1);
+   fclose(psFile);
+   iNumFreedValues = 0;
+   ASSURE(SymTable_load(pcPath, loadString, freeLoadedValue) == NULL);
+   ASSURE(iNumFreedValues == 1);
+
+   /* A count larger than the file could hold is refused before
+      anything is allocated for it. */
+   uHugeCount = UINT64_C(1) << 40;
+   memcpy(acSnapshot + 2 * sizeof(uint64_t), &uHugeCount,
+      sizeof(uHugeCount));
+   psFile = fopen(pcPath, "wb");
+   ASSURE(psFile != NULL);
+   ASSURE(fwrite(acSnapshot, 1, uSize, psFile) == uSize);
+   fclose(psFile);
+   iNumFreedValues = 0;
+   ASSURE(SymTable_load(pcPath, loadString, freeLoadedValue) == NULL);
+   ASSURE(iNumFreedValues == 0);
+
+   /* Compare loading a large snapshot with putting its bindings. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   iInitialClock = clock();
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_put(oSymTable, acKey, (void*)(size_t)i));
+   }
+   iFinalClock = clock();
+   printf("CPU time (%d bindings put):  %f seconds\n", iBindingCount,
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+   ASSURE(SymTable_save(oSymTable, pcPath, saveNumber));
+   SymTable_free(oSymTable);
+
+   iInitialClock = clock();
+   oLoaded = SymTable_load(pcPath, loadNumber, NULL);
+   iFinalClock = clock();
+   printf("CPU time (%d bindings loaded):  %f seconds\n",
+      iBindingCount,
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+   fflush(stdout);
+   ASSURE(oLoaded != NULL);
+   ASSURE(SymTable_getLength(oLoaded) == (size_t)iBindingCount);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_get(oLoaded, acKey) == (void*)(size_t)i);
+   }
+   SymTable_free(oLoaded);
+
+   remove(pcPath);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the extensions that symtablehash.h adds to the SymTable
+   ADT. Write the output of the tests to stdout. As always, argc is
+   the command-line argument count, argv contains the command-line
+   arguments, and argv[0] is the name of the executable binary file.
+   argv[1] is the number of bindings to use when timing bulk
+   operations. Exit with EXIT_FAILURE if argv[1] is missing or not
+   numeric.  Otherwise return 0. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1)
+   {
+      fprintf(stderr, "bindingcount must be numeric\n");
+      exit(EXIT_FAILURE);
+   }
+   if (iBindingCount < 0)
+   {
+      fprintf(stderr, "bindingcount cannot be negative\n");
+      exit(EXIT_FAILURE);
+   }
+
+   testOps();
+   testPrehash();
+   testGetMany();
+   testCapacity();
+   testIter();
+   testAtoms();
+   testBorrowedKeys();
+   testKeySlices();
+   testPutMany(iBindingCount);
+   testSnapshot(iBindingCount);
+   testMapParallel(iBindingCount);
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}
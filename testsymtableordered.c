@@ -0,0 +1,366 @@
+/*--------------------------------------------------------------------*/
+/* testsymtableordered.c                                              */
+/* Author: Angel Chang Liu                                            */
+/*--------------------------------------------------------------------*/
+
+#include "symtableordered.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The longest key that a walk records */
+
+enum {MAX_WALK_KEY_LENGTH = 32};
+
+/* What a walk over a SymTable object has seen so far */
+
+struct Walk
+{
+   /* The number of bindings visited */
+   size_t uCount;
+   /* A copy of the key of the last binding visited, which need not
+      stay valid after pfApply returns */
+   char acLastKey[MAX_WALK_KEY_LENGTH + 1];
+   /* Nonzero (TRUE) if every key came after the one before */
+   int iSorted;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Record in the struct Walk pvExtra that the binding with key pcKey
+   was visited. */
+
+static void visitBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   struct Walk *psWalk = (struct Walk*)pvExtra;
+
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+
+   (void)pvValue;
+   assert(strlen(pcKey) <= MAX_WALK_KEY_LENGTH);
+   if (psWalk->uCount > 0 && strcmp(psWalk->acLastKey, pcKey) >= 0)
+      psWalk->iSorted = 0;
+   strcpy(psWalk->acLastKey, pcKey);
+   psWalk->uCount++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* A count of the keys that start with a prefix */
+
+struct PrefixCount
+{
+   /* The prefix */
+   const char *pcPrefix;
+   /* The number of keys seen that start with pcPrefix */
+   size_t uCount;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Count pcKey in the struct PrefixCount pvExtra if it starts with the
+   prefix. */
+
+static void countIfPrefixed(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   struct PrefixCount *psCount = (struct PrefixCount*)pvExtra;
+
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+
+   (void)pvValue;
+   if (strncmp(pcKey, psCount->pcPrefix, strlen(psCount->pcPrefix))
+      == 0)
+      psCount->uCount++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Start *psWalk over. */
+
+static void startWalk(struct Walk *psWalk)
+{
+   assert(psWalk != NULL);
+
+   psWalk->uCount = 0;
+   psWalk->acLastKey[0] = '\0';
+   psWalk->iSorted = 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bindings of oSymTable whose keys are at least
+   pcLow and less than pcHigh, as SymTable_mapRange() finds them, or
+   (size_t)-1 if it does not find them in order. */
+
+static size_t countRange(SymTable_T oSymTable, const char *pcLow,
+   const char *pcHigh)
+{
+   struct Walk sWalk;
+
+   startWalk(&sWalk);
+   SymTable_mapRange(oSymTable, pcLow, pcHigh, visitBinding, &sWalk);
+   return sWalk.iSorted ? sWalk.uCount : (size_t)-1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the number of bindings of oSymTable whose keys start with
+   pcPrefix, as SymTable_mapPrefix() finds them, or (size_t)-1 if it
+   does not find them in order. */
+
+static size_t countPrefix(SymTable_T oSymTable, const char *pcPrefix)
+{
+   struct Walk sWalk;
+
+   startWalk(&sWalk);
+   SymTable_mapPrefix(oSymTable, pcPrefix, visitBinding, &sWalk);
+   return sWalk.iSorted ? sWalk.uCount : (size_t)-1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_mapRange() and SymTable_mapPrefix() on a few keys,
+   some of which share more than 8 leading characters. */
+
+static void testRangeAndPrefix(void)
+{
+   SymTable_T oSymTable;
+   const char *apcKeys[] = {"stdio", "std::vector", "std::map",
+      "std::map::iterator", "std::mapped", "boost::asio", "", "z",
+      "namespace::alpha", "namespace::beta", "namespace::alphabet"};
+   size_t uKeyCount = sizeof(apcKeys) / sizeof(apcKeys[0]);
+   struct Walk sWalk;
+   size_t u;
+   int iSuccessful;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable_mapRange() and SymTable_mapPrefix().\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (u = 0; u < uKeyCount; u++)
+   {
+      iSuccessful = SymTable_put(oSymTable, apcKeys[u], NULL);
+      ASSURE(iSuccessful);
+   }
+
+   /* SymTable_map() visits every binding in order. */
+   startWalk(&sWalk);
+   SymTable_map(oSymTable, visitBinding, &sWalk);
+   ASSURE(sWalk.iSorted);
+   ASSURE(sWalk.uCount == uKeyCount);
+
+   /* Ranges include pcLow but not pcHigh, and NULL bounds are
+      open. */
+   ASSURE(countRange(oSymTable, NULL, NULL) == uKeyCount);
+   ASSURE(countRange(oSymTable, "std::map", "std::vector") == 3);
+   ASSURE(countRange(oSymTable, "std::map", "std::mapped") == 2);
+   ASSURE(countRange(oSymTable, "std::ma", "std::mb") == 3);
+   ASSURE(countRange(oSymTable, NULL, "boost::asio") == 1);
+   ASSURE(countRange(oSymTable, "stdio", NULL) == 2);
+   ASSURE(countRange(oSymTable, "z", "z") == 0);
+   ASSURE(countRange(oSymTable, "z", "a") == 0);
+   ASSURE(countRange(oSymTable, "zz", NULL) == 0);
+
+   /* The keys with a prefix are exactly those found. */
+   ASSURE(countPrefix(oSymTable, "std::") == 4);
+   ASSURE(countPrefix(oSymTable, "std") == 5);
+   ASSURE(countPrefix(oSymTable, "std::map") == 3);
+   ASSURE(countPrefix(oSymTable, "namespace::alpha") == 2);
+   ASSURE(countPrefix(oSymTable, "namespace::") == 3);
+   ASSURE(countPrefix(oSymTable, "") == uKeyCount);
+   ASSURE(countPrefix(oSymTable, "q") == 0);
+   ASSURE(countPrefix(oSymTable, "zz") == 0);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put iBindingCount bindings into a SymTable object in a scrambled
+   order, remove two thirds of them, and check that the rest are still
+   found and visited in order. Then compare the time that
+   SymTable_mapPrefix() takes to find the keys under a prefix with the
+   time that a filtering SymTable_map() takes. Write the times
+   consumed to stdout. */
+
+static void testLargeOrdered(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 24, SCAN_COUNT = 100};
+
+   SymTable_T oSymTable;
+   int *aiOrder;
+   char acKey[MAX_KEY_LENGTH];
+   struct Walk sWalk;
+   struct PrefixCount sCount;
+   size_t uExpected;
+   size_t uFound;
+   int i;
+   int j;
+   int iTemp;
+   int iSuccessful;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a potentially large ordered SymTable object.\n");
+   printf("No output except CPU time consumed should appear here:\n");
+   fflush(stdout);
+
+   aiOrder = (int*)malloc(((size_t)iBindingCount + 1) * sizeof(int));
+   ASSURE(aiOrder != NULL);
+   for (i = 0; i < iBindingCount; i++)
+      aiOrder[i] = i;
+
+   /* Put the bindings in a random order. Half of the keys share a
+      prefix longer than 8 characters. */
+   srand(1);
+   for (i = iBindingCount - 1; i > 0; i--)
+   {
+      j = rand() % (i + 1);
+      iTemp = aiOrder[i];
+      aiOrder[i] = aiOrder[j];
+      aiOrder[j] = iTemp;
+   }
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   iInitialClock = clock();
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, aiOrder[i] % 2 ? "%d" : "namespace::%d",
+         aiOrder[i]);
+      iSuccessful = SymTable_put(oSymTable, acKey, &aiOrder[i]);
+      ASSURE(iSuccessful);
+   }
+   iFinalClock = clock();
+   printf("CPU time (%d bindings put):  %f seconds\n", iBindingCount,
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+
+   /* Remove the bindings of every multiple of 2 or 3, in the order
+      they were put, so that nodes all over the tree shrink. */
+   for (i = 0; i < iBindingCount; i++)
+   {
+      if (aiOrder[i] % 2 != 0 && aiOrder[i] % 3 != 0)
+         continue;
+      sprintf(acKey, aiOrder[i] % 2 ? "%d" : "namespace::%d",
+         aiOrder[i]);
+      ASSURE(SymTable_remove(oSymTable, acKey) == &aiOrder[i]);
+      ASSURE(SymTable_remove(oSymTable, acKey) == NULL);
+   }
+
+   uExpected = 0;
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, i % 2 ? "%d" : "namespace::%d", i);
+      ASSURE(SymTable_contains(oSymTable, acKey) ==
+         (i % 2 != 0 && i % 3 != 0));
+      if (i % 2 != 0 && i % 3 != 0)
+         uExpected++;
+   }
+   ASSURE(SymTable_getLength(oSymTable) == uExpected);
+   startWalk(&sWalk);
+   SymTable_map(oSymTable, visitBinding, &sWalk);
+   ASSURE(sWalk.iSorted);
+   ASSURE(sWalk.uCount == uExpected);
+
+   /* Find the keys that start with "11" both ways. */
+   uExpected = 0;
+   iInitialClock = clock();
+   for (i = 0; i < SCAN_COUNT; i++)
+      uExpected = countPrefix(oSymTable, "11");
+   iFinalClock = clock();
+   printf("CPU time (%d prefix scans):  %f seconds\n", SCAN_COUNT,
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+
+   sCount.pcPrefix = "11";
+   sCount.uCount = 0;
+   iInitialClock = clock();
+   for (i = 0; i < SCAN_COUNT; i++)
+   {
+      sCount.uCount = 0;
+      SymTable_map(oSymTable, countIfPrefixed, &sCount);
+   }
+   iFinalClock = clock();
+   printf("CPU time (%d full scans):  %f seconds\n", SCAN_COUNT,
+      ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC);
+   ASSURE(sCount.uCount == uExpected);
+   uFound = countRange(oSymTable, "11", "12");
+   ASSURE(uFound == uExpected);
+
+   /* Remove everything, leaving a table that still works. */
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, i % 2 ? "%d" : "namespace::%d", i);
+      (void)SymTable_remove(oSymTable, acKey);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == 0);
+   ASSURE(countRange(oSymTable, NULL, NULL) == 0);
+   iSuccessful = SymTable_put(oSymTable, "Jeter", NULL);
+   ASSURE(iSuccessful);
+   ASSURE(countPrefix(oSymTable, "J") == 1);
+
+   SymTable_free(oSymTable);
+   free(aiOrder);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the ordered SymTable extensions with argv[1] bindings. As
+   always, return 0. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1)
+   {
+      fprintf(stderr, "bindingcount must be numeric\n");
+      exit(EXIT_FAILURE);
+   }
+   if (iBindingCount < 0)
+   {
+      fprintf(stderr, "bindingcount cannot be negative\n");
+      exit(EXIT_FAILURE);
+   }
+
+   testRangeAndPrefix();
+   testLargeOrdered(iBindingCount);
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}
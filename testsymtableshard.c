@@ -0,0 +1,290 @@
+/*--------------------------------------------------------------------*/
+/* testsymtableshard.c                                                */
+/* Author: Angel Chang Liu                                            */
+/*--------------------------------------------------------------------*/
+
+/* clock_gettime() is a POSIX feature beyond plain C99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include "symtableshard.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the elapsed wall clock time in seconds since some fixed
+   point. Unlike clock(), this does not add up the time of all of
+   the threads. */
+
+static double getWallTime(void)
+{
+   struct timespec sTime;
+
+   clock_gettime(CLOCK_MONOTONIC, &sTime);
+   return (double)sTime.tv_sec + (double)sTime.tv_nsec / 1e9;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Increment the size_t that pvExtra points to. */
+
+static void countBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+
+   (void)pvValue;
+   (*(size_t*)pvExtra)++;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the basic operations of ShardSymTable objects with one and
+   with several shards, from one thread. */
+
+static void testBasics(void)
+{
+   enum {BINDING_COUNT = 1000, MAX_KEY_LENGTH = 12};
+
+   ShardSymTable_T oShardSymTable;
+   size_t auShards[] = {1, 7, 64};
+   char acKey[MAX_KEY_LENGTH];
+   char acShortstop[] = "Shortstop";
+   char acCenterField[] = "Center Field";
+   size_t uCount;
+   size_t s;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the basic operations of ShardSymTable objects.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   for (s = 0; s < sizeof(auShards) / sizeof(auShards[0]); s++)
+   {
+      oShardSymTable = ShardSymTable_new(auShards[s]);
+      ASSURE(oShardSymTable != NULL);
+      ASSURE(ShardSymTable_getLength(oShardSymTable) == 0);
+
+      iSuccessful = ShardSymTable_put(oShardSymTable, "Jeter",
+         acShortstop);
+      ASSURE(iSuccessful);
+      iSuccessful = ShardSymTable_put(oShardSymTable, "Jeter",
+         acCenterField);
+      ASSURE(! iSuccessful);
+      ASSURE(ShardSymTable_get(oShardSymTable, "Jeter") ==
+         acShortstop);
+      ASSURE(ShardSymTable_replace(oShardSymTable, "Jeter",
+         acCenterField) == acShortstop);
+      ASSURE(ShardSymTable_replace(oShardSymTable, "Mantle",
+         acCenterField) == NULL);
+      iSuccessful = ShardSymTable_upsert(oShardSymTable, "Mantle",
+         acCenterField);
+      ASSURE(iSuccessful);
+      ASSURE(ShardSymTable_contains(oShardSymTable, "Mantle"));
+      ASSURE(ShardSymTable_getLength(oShardSymTable) == 2);
+      ASSURE(ShardSymTable_remove(oShardSymTable, "Jeter") ==
+         acCenterField);
+      ASSURE(! ShardSymTable_contains(oShardSymTable, "Jeter"));
+      ASSURE(ShardSymTable_getLength(oShardSymTable) == 1);
+
+      for (i = 0; i < BINDING_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         iSuccessful = ShardSymTable_put(oShardSymTable, acKey,
+            acShortstop);
+         ASSURE(iSuccessful);
+      }
+      ASSURE(ShardSymTable_getLength(oShardSymTable) ==
+         BINDING_COUNT + 1);
+      uCount = 0;
+      ShardSymTable_map(oShardSymTable, countBinding, &uCount);
+      ASSURE(uCount == BINDING_COUNT + 1);
+
+      ShardSymTable_free(oShardSymTable);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The work of one thread of the ingest test */
+
+struct Worker
+{
+   /* The table that all threads share */
+   ShardSymTable_T oShardSymTable;
+   /* This thread's keys are the decimal numbers iFirst to iLast-1 */
+   int iFirst;
+   int iLast;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Put the keys of the struct Worker pvWorker into its table. Return
+   NULL. */
+
+static void *ingest(void *pvWorker)
+{
+   enum {MAX_KEY_LENGTH = 12};
+
+   struct Worker *psWorker = (struct Worker*)pvWorker;
+   char acKey[MAX_KEY_LENGTH];
+   int iSuccessful;
+   int i;
+
+   for (i = psWorker->iFirst; i < psWorker->iLast; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = ShardSymTable_put(psWorker->oShardSymTable, acKey,
+         "value");
+      ASSURE(iSuccessful);
+   }
+   return NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put iBindingCount keys into ShardSymTable objects of 1 shard and
+   of many shards, from iThreadCount threads at once, each with keys
+   of its own. Check the resulting tables, and print the wall clock
+   time each ingest takes. */
+
+static void testIngest(int iBindingCount, int iThreadCount)
+{
+   enum {MAX_KEY_LENGTH = 12};
+
+   ShardSymTable_T oShardSymTable;
+   struct Worker *psWorkers;
+   pthread_t *aThreads;
+   size_t auShards[2];
+   char acKey[MAX_KEY_LENGTH];
+   double dStart;
+   size_t s;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing %d threads putting into a ShardSymTable object.\n",
+      iThreadCount);
+   printf("No output except wall clock time should appear here:\n");
+   fflush(stdout);
+
+   /* one shard serializes the threads; four shards per thread rarely
+      do */
+   auShards[0] = 1;
+   auShards[1] = 4 * (size_t)iThreadCount;
+
+   psWorkers = (struct Worker*)malloc((size_t)iThreadCount *
+      sizeof(struct Worker));
+   ASSURE(psWorkers != NULL);
+   aThreads = (pthread_t*)malloc((size_t)iThreadCount *
+      sizeof(pthread_t));
+   ASSURE(aThreads != NULL);
+
+   for (s = 0; s < sizeof(auShards) / sizeof(auShards[0]); s++)
+   {
+      oShardSymTable = ShardSymTable_new(auShards[s]);
+      ASSURE(oShardSymTable != NULL);
+
+      dStart = getWallTime();
+      for (i = 0; i < iThreadCount; i++)
+      {
+         psWorkers[i].oShardSymTable = oShardSymTable;
+         psWorkers[i].iFirst = (int)((long)iBindingCount * i /
+            iThreadCount);
+         psWorkers[i].iLast = (int)((long)iBindingCount * (i + 1) /
+            iThreadCount);
+         iSuccessful = pthread_create(&aThreads[i], NULL, ingest,
+            &psWorkers[i]) == 0;
+         ASSURE(iSuccessful);
+      }
+      for (i = 0; i < iThreadCount; i++)
+         pthread_join(aThreads[i], NULL);
+      printf("%4lu shards: %f seconds\n", (unsigned long)auShards[s],
+         getWallTime() - dStart);
+      fflush(stdout);
+
+      ASSURE(ShardSymTable_getLength(oShardSymTable) ==
+         (size_t)iBindingCount);
+      for (i = 0; i < iBindingCount; i++)
+      {
+         sprintf(acKey, "%d", i);
+         ASSURE(ShardSymTable_contains(oShardSymTable, acKey));
+      }
+      ShardSymTable_free(oShardSymTable);
+   }
+
+   free(aThreads);
+   free(psWorkers);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test ShardSymTable with argv[1] bindings and argv[2] threads. As
+   always, return 0. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+   int iThreadCount;
+
+   if (argc != 3)
+   {
+      fprintf(stderr, "Usage: %s bindingcount threadcount\n",
+         argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1)
+   {
+      fprintf(stderr, "bindingcount must be numeric\n");
+      exit(EXIT_FAILURE);
+   }
+   if (iBindingCount < 0)
+   {
+      fprintf(stderr, "bindingcount cannot be negative\n");
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[2], "%d", &iThreadCount) != 1)
+   {
+      fprintf(stderr, "threadcount must be numeric\n");
+      exit(EXIT_FAILURE);
+   }
+   if (iThreadCount < 1)
+   {
+      fprintf(stderr, "threadcount must be at least 1\n");
+      exit(EXIT_FAILURE);
+   }
+
+   testBasics();
+   testIngest(iBindingCount, iThreadCount);
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}